@@ -0,0 +1,106 @@
+//speedup of DataParallelRunner with the number of workers, on the summed loss of a small model over many points.
+//the model is a one hidden layer tanh network with 8 data inputs and a squared error, so the parameters are most of
+//the gradient. prints one CSV row per worker count.
+//usage: bench_data_parallel [--points N] [--max-workers N]
+#include "dataParallel.h"
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+typedef chrono::steady_clock Clock;
+
+int main(int argc, char** argv) {
+	int nPoints = 200000;
+	int maxWorkers = max(1, (int)sysconf(_SC_NPROCESSORS_ONLN));
+	for(int i=1; i+1<argc; i+=2) {
+		if(strcmp(argv[i], "--points") == 0) {
+			nPoints = atoi(argv[i+1]);
+		} else if(strcmp(argv[i], "--max-workers") == 0) {
+			maxWorkers = atoi(argv[i+1]);
+		} else {
+			cerr << "unknown option " << argv[i] << "\n";
+			return 1;
+		}
+	}
+
+	const int nData = 8, nHidden = 8;
+	ad::Graph graph;
+	vector<ad::Node*> inputs;
+	vector<int> parameterInputs;
+	auto parameter = [&]() -> ad::Node& {
+		parameterInputs.push_back(inputs.size());
+		inputs.push_back(&graph.input());
+		return *inputs.back();
+	};
+	vector<ad::Node*> x;
+	for(int i=0; i<nData; i++) {
+		inputs.push_back(&graph.input());
+		x.push_back(inputs.back());
+	}
+	ad::Node& target = graph.input();
+	inputs.push_back(&target);
+	vector<ad::Node*> outputTerms;
+	for(int j=0; j<nHidden; j++) {
+		vector<ad::Node*> terms = {&parameter()};
+		for(int i=0; i<nData; i++) {
+			terms.push_back(&(parameter() * *x[i]));
+		}
+		outputTerms.push_back(&(parameter() * tanh(ad::sum(terms))));
+	}
+	ad::Node& error = ad::sum(outputTerms) - target;
+	ad::Node& loss = error*error;
+	(void)loss;
+	ad::Function function(inputs);
+	function.setChecked(false);
+	vector<bool> mask(inputs.size(), false);
+	for(int p : parameterInputs) {
+		mask[p] = true;
+	}
+	function.setRequiresGradient(mask);
+
+	unsigned seed = 1;
+	auto uniform = [&]() {
+		seed = seed*1103515245 + 12345;
+		return ((seed >> 8) % 2000)/1000.0 - 1.0;
+	};
+	vector<vector<double>> points(nPoints, vector<double>(inputs.size(), 0.0));
+	for(vector<double>& point : points) {
+		double y = 0;
+		for(int i=0; i<nData; i++) {
+			point[i] = uniform();
+			y += point[i]*(i%3 - 1);
+		}
+		point[nData] = tanh(y);
+	}
+	vector<double> parameters(parameterInputs.size());
+	for(double& value : parameters) {
+		value = 0.3*uniform();
+	}
+
+	try {
+		cout << "workers,seconds_per_call,speedup,loss\n";
+		double baseline = 0;
+		for(int nWorkers=1; nWorkers<=maxWorkers; nWorkers*=2) {
+			ad::DataParallelRunner runner(function, points, nWorkers, parameterInputs);
+			//the first call faults in each worker's copy of the pages it reads
+			runner.differentiateSum(parameters);
+			int reps = 5;
+			Clock::time_point start = Clock::now();
+			double value = 0;
+			for(int r=0; r<reps; r++) {
+				value = runner.differentiateSum(parameters).value;
+			}
+			double seconds = chrono::duration<double>(Clock::now() - start).count()/reps;
+			if(nWorkers == 1) {
+				baseline = seconds;
+			}
+			cout << nWorkers << "," << seconds << "," << baseline/seconds << "," << value << "\n";
+		}
+	} catch(const char* e) {
+		cerr << e << "\n";
+		return 1;
+	}
+	return 0;
+}
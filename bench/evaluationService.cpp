@@ -0,0 +1,137 @@
+//throughput vs latency of EvaluationService, compared with answering each query on its own.
+//clients keep a fixed number of requests in flight; prints one CSV row per configuration.
+#include "evaluationService.h"
+#include <iostream>
+#include <deque>
+
+using namespace std;
+typedef chrono::steady_clock Clock;
+
+struct Result {
+	double throughput; //requests per second
+	double p50; //microseconds
+	double p99;
+};
+
+Result summarize(vector<double>& latencies, double seconds) {
+	sort(latencies.begin(), latencies.end());
+	int n = latencies.size();
+	Result result;
+	result.throughput = n/seconds;
+	result.p50 = latencies[n/2];
+	result.p99 = latencies[min(n-1, (int)(0.99*n))];
+	return result;
+}
+
+vector<double> randomPoint(int nInputs, unsigned& seed) {
+	vector<double> point(nInputs);
+	for(int i=0; i<nInputs; i++) {
+		seed = seed*1103515245 + 12345;
+		point[i] = 1.0 + (seed % 1000)/1000.0;
+	}
+	return point;
+}
+
+//each query evaluated on the client thread, one point at a time
+Result runDirect(const ad::Function& func, int nThreads, int requestsPerThread) {
+	vector<vector<double>> latencies(nThreads);
+	Clock::time_point start = Clock::now();
+	vector<thread> threads;
+	for(int t=0; t<nThreads; t++) {
+		threads.push_back(thread([&, t]{
+			unsigned seed = t+1;
+			for(int r=0; r<requestsPerThread; r++) {
+				Clock::time_point sent = Clock::now();
+				func.differentiateBatch({randomPoint(func.inputCount(), seed)});
+				latencies[t].push_back(chrono::duration<double, micro>(Clock::now() - sent).count());
+			}
+		}));
+	}
+	for(thread& t : threads) {
+		t.join();
+	}
+	double seconds = chrono::duration<double>(Clock::now() - start).count();
+	vector<double> all;
+	for(vector<double>& l : latencies) {
+		all.insert(all.end(), l.begin(), l.end());
+	}
+	return summarize(all, seconds);
+}
+
+Result runService(const ad::Function& func, int nThreads, int requestsPerThread, int inFlight, int budgetMicroseconds) {
+	ad::EvaluationService service(func, chrono::microseconds(budgetMicroseconds));
+	vector<vector<double>> latencies(nThreads);
+	Clock::time_point start = Clock::now();
+	vector<thread> threads;
+	for(int t=0; t<nThreads; t++) {
+		threads.push_back(thread([&, t]{
+			unsigned seed = t+1;
+			deque<pair<Clock::time_point, future<ad::ValueAndGradient>>> window;
+			for(int r=0; r<requestsPerThread; r++) {
+				if((int)window.size() == inFlight) {
+					window.front().second.get();
+					latencies[t].push_back(chrono::duration<double, micro>(Clock::now() - window.front().first).count());
+					window.pop_front();
+				}
+				window.push_back(make_pair(Clock::now(), service.submit(randomPoint(func.inputCount(), seed))));
+			}
+			while(!window.empty()) {
+				window.front().second.get();
+				latencies[t].push_back(chrono::duration<double, micro>(Clock::now() - window.front().first).count());
+				window.pop_front();
+			}
+		}));
+	}
+	for(thread& t : threads) {
+		t.join();
+	}
+	double seconds = chrono::duration<double>(Clock::now() - start).count();
+	vector<double> all;
+	for(vector<double>& l : latencies) {
+		all.insert(all.end(), l.begin(), l.end());
+	}
+	return summarize(all, seconds);
+}
+
+int main() {
+	try {
+		//sum of 8 copies of the formula in examples/example.cpp, 24 inputs
+		const int nTerms = 8;
+		vector<ad::Node> x(3*nTerms);
+		vector<ad::Node> n1(nTerms), n2(nTerms), terms(nTerms); //named nodes must outlive the function
+		for(int k=0; k<nTerms; k++) {
+			ad::Node& x1 = x[3*k];
+			ad::Node& x2 = x[3*k+1];
+			ad::Node& x3 = x[3*k+2];
+			n1[k] = (4 + 2*x1 + 3*x2 - 5*x3)/(x1+x3);
+			n2[k] = exp(x1/x2);
+			n2[k] += n1[k] * n2[k];
+			terms[k] = log(n1[k] * n1[k] * n2[k] * n2[k]);
+		}
+		ad::Node output = terms[0];
+		for(int k=1; k<nTerms; k++) {
+			output += terms[k];
+		}
+		vector<ad::Node*> inputs;
+		for(ad::Node& node : x) {
+			inputs.push_back(&node);
+		}
+		ad::Function func(inputs);
+		func.setChecked(false);
+		
+		const int nThreads = 8;
+		const int requestsPerThread = 20000;
+		cout << "mode,threads,in_flight,budget_us,throughput_rps,p50_us,p99_us\n";
+		Result direct = runDirect(func, nThreads, requestsPerThread);
+		cout << "direct," << nThreads << ",1,0," << direct.throughput << "," << direct.p50 << "," << direct.p99 << "\n";
+		for(int inFlight : {1, 8, 32}) {
+			for(int budget : {0, 20, 100, 500}) {
+				Result r = runService(func, nThreads, requestsPerThread, inFlight, budget);
+				cout << "service," << nThreads << "," << inFlight << "," << budget << "," << r.throughput << "," << r.p50 << "," << r.p99 << "\n";
+			}
+		}
+	}
+	catch(const char* err) {
+		cout << "Error: " << err << "\n";
+	}
+}
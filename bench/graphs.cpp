@@ -0,0 +1,309 @@
+//cost of each stage of a graph's life, per node, on families of generated graphs from 10 nodes up.
+//stages: building the nodes, constructing the Function, evaluate, differentiate (checked and unchecked), and teardown.
+//also the peak heap in use and the number of allocations made by each stage.
+//each graph is built both in an ad::Graph and as free-standing nodes. prints one CSV row per graph.
+//usage: bench_graphs [--max-nodes N] [--families chain,wide,diamond,mlp,example] [--storage graph|nodes|both] [--out file]
+#include "autoDiff.h"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+//heap accounting: every allocation carries a header recording its size, so that delete can take it off the live total.
+//this is separate from AD_PROFILE_COUNT_ALLOCATIONS in profiler.h, which only counts allocations: the peak needs sizes,
+//and defining AD_PROFILE here would put the profiler's own bookkeeping into the timings
+namespace {
+	const size_t headerSize = 16;
+	size_t liveBytes = 0;
+	size_t peakBytes = 0;
+	long long allocations = 0;
+}
+
+__attribute__((noinline)) void* operator new(size_t size) {
+	char* block = static_cast<char*>(malloc(size + headerSize));
+	if(block == nullptr) {
+		throw bad_alloc();
+	}
+	*reinterpret_cast<size_t*>(block) = size;
+	liveBytes += size;
+	peakBytes = max(peakBytes, liveBytes);
+	allocations++;
+	return block + headerSize;
+}
+
+__attribute__((noinline)) void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void* pointer) noexcept {
+	if(pointer == nullptr) {
+		return;
+	}
+	char* block = static_cast<char*>(pointer) - headerSize;
+	liveBytes -= *reinterpret_cast<size_t*>(block);
+	free(block);
+}
+
+__attribute__((noinline)) void operator delete[](void* pointer) noexcept {
+	operator delete(pointer);
+}
+
+typedef chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start) {
+	return chrono::duration<double>(Clock::now() - start).count();
+}
+
+//where a graph's nodes live. the free-standing version keeps the inputs in a vector and lets every other node be
+//dynamically allocated, owned by a single named output node
+struct GraphStorage {
+	ad::Graph* graph;
+	vector<ad::Node> freeInputs;
+	vector<ad::Node*> inputs;
+	ad::Node* output;
+
+	GraphStorage(bool useGraph, int nInputs): graph(useGraph ? new ad::Graph : nullptr), freeInputs(useGraph ? 0 : nInputs), output(nullptr) {
+		for(int i=0; i<nInputs; i++) {
+			inputs.push_back(useGraph ? &graph->input() : &freeInputs[i]);
+		}
+	}
+	void setOutput(ad::Node& node) {
+		output = graph != nullptr ? &node : new ad::Node(node);
+	}
+	~GraphStorage() {
+		if(graph != nullptr) {
+			delete graph;
+		} else {
+			delete output;
+		}
+	}
+};
+
+//the families. each takes a target node count and builds roughly that many nodes
+
+//x -> tanh(x)*0.5 + x -> ..., one input shared by every link
+GraphStorage* buildChain(bool useGraph, long long size) {
+	GraphStorage* storage = new GraphStorage(useGraph, 1);
+	ad::Node& x = *storage->inputs[0];
+	ad::Node* current = &(x*0.5);
+	for(long long i=0; i<size/3; i++) {
+		current = &(tanh(*current)*0.5 + x);
+	}
+	storage->setOutput(*current);
+	return storage;
+}
+
+//one n-ary sum of weighted inputs
+GraphStorage* buildWide(bool useGraph, long long size) {
+	int nInputs = max(1LL, size/2);
+	GraphStorage* storage = new GraphStorage(useGraph, nInputs);
+	vector<ad::Node*> terms;
+	for(int i=0; i<nInputs; i++) {
+		terms.push_back(&(*storage->inputs[i] * (1.0 + i%7)));
+	}
+	storage->setOutput(ad::sum(terms));
+	return storage;
+}
+
+//a lattice of fixed width where every node feeds two nodes of the next layer, so paths keep splitting and rejoining
+GraphStorage* buildDiamond(bool useGraph, long long size) {
+	const int width = 8;
+	GraphStorage* storage = new GraphStorage(useGraph, width);
+	vector<ad::Node*> layer = storage->inputs;
+	for(long long l=0; l<max(1LL, size/(2*width)); l++) {
+		vector<ad::Node*> next(width);
+		for(int i=0; i<width; i++) {
+			next[i] = &tanh(*layer[i] + *layer[(i+1)%width]);
+		}
+		layer = next;
+	}
+	storage->setOutput(ad::sum(layer));
+	return storage;
+}
+
+//dense scalar MLP: each unit is tanh of a weighted sum of the previous layer. depth grows with size
+GraphStorage* buildMlp(bool useGraph, long long size) {
+	int width = 2;
+	while(width < 32 && (long long)(2*width)*(2*width + 2) <= size) {
+		width *= 2;
+	}
+	GraphStorage* storage = new GraphStorage(useGraph, width);
+	vector<ad::Node*> layer = storage->inputs;
+	unsigned seed = 1;
+	for(long long l=0; l<max(1LL, size/(width*(width + 2))); l++) {
+		vector<ad::Node*> next(width);
+		for(int j=0; j<width; j++) {
+			vector<ad::Node*> terms;
+			for(int i=0; i<width; i++) {
+				seed = seed*1103515245 + 12345;
+				terms.push_back(&(*layer[i] * (((seed >> 8) % 2000)/1000.0 - 1.0)/width));
+			}
+			next[j] = &tanh(ad::sum(terms));
+		}
+		layer = next;
+	}
+	storage->setOutput(ad::sum(layer));
+	return storage;
+}
+
+//the formula from examples/example.cpp, on its own inputs for each copy, with the copies summed
+GraphStorage* buildExample(bool useGraph, long long size) {
+	int nCopies = max(1LL, size/20);
+	GraphStorage* storage = new GraphStorage(useGraph, 3*nCopies);
+	vector<ad::Node*> copies;
+	for(int c=0; c<nCopies; c++) {
+		ad::Node& x1 = *storage->inputs[3*c];
+		ad::Node& x2 = *storage->inputs[3*c + 1];
+		ad::Node& x3 = *storage->inputs[3*c + 2];
+		ad::Node& n1 = (4 + 2*x1 + 3*x2 - 5*x3)/(x1 + x3);
+		ad::Node& n2 = exp(x1/x2);
+		ad::Node& n3 = n2 + n1*n2;
+		copies.push_back(&(log(n1*n1*n3*n3)/2));
+	}
+	storage->setOutput(ad::sum(copies));
+	return storage;
+}
+
+struct Family {
+	string name;
+	GraphStorage* (*build)(bool, long long);
+};
+
+struct Result {
+	int nodes, inputs;
+	double build, function, evaluate, differentiate, evaluateUnchecked, differentiateUnchecked, teardown; //ns per node
+	size_t peakBytes;
+	long long buildAllocations, functionAllocations, evaluateAllocations, differentiateAllocations; //the last two per call
+};
+
+Result run(const Family& family, bool useGraph, long long size) {
+	Result result;
+	size_t startBytes = liveBytes;
+	peakBytes = liveBytes;
+
+	long long startAllocations = allocations;
+	Clock::time_point start = Clock::now();
+	GraphStorage* storage = family.build(useGraph, size);
+	double buildSeconds = secondsSince(start);
+	result.buildAllocations = allocations - startAllocations;
+
+	startAllocations = allocations;
+	start = Clock::now();
+	ad::Function* func = new ad::Function(storage->inputs);
+	double functionSeconds = secondsSince(start);
+	result.functionAllocations = allocations - startAllocations;
+	result.nodes = func->nodeCount();
+	result.inputs = func->inputCount();
+	//all rates are per node of the compiled function, after flattening
+	double nodes = result.nodes;
+
+	vector<double> args(result.inputs);
+	for(int i=0; i<result.inputs; i++) {
+		args[i] = 0.1 + 0.01*(i%50);
+	}
+	int reps = max(1LL, min(1000LL, 2000000LL/result.nodes));
+	double check(0.0);
+
+	for(int checked=1; checked>=0; checked--) {
+		func->setChecked(checked == 1);
+		startAllocations = allocations;
+		start = Clock::now();
+		for(int r=0; r<reps; r++) {
+			check += func->evaluate(args);
+		}
+		double evaluateSeconds = secondsSince(start)/reps;
+		long long evaluateAllocations = (allocations - startAllocations)/reps;
+
+		startAllocations = allocations;
+		start = Clock::now();
+		for(int r=0; r<reps; r++) {
+			check += func->differentiate(args)[0];
+		}
+		double differentiateSeconds = secondsSince(start)/reps;
+		long long differentiateAllocations = (allocations - startAllocations)/reps;
+
+		if(checked == 1) {
+			result.evaluate = evaluateSeconds*1e9/nodes;
+			result.differentiate = differentiateSeconds*1e9/nodes;
+			result.evaluateAllocations = evaluateAllocations;
+			result.differentiateAllocations = differentiateAllocations;
+		} else {
+			result.evaluateUnchecked = evaluateSeconds*1e9/nodes;
+			result.differentiateUnchecked = differentiateSeconds*1e9/nodes;
+		}
+	}
+	if(check != check) {
+		cerr << "NaN in results for " << family.name << "\n";
+	}
+
+	start = Clock::now();
+	delete func;
+	delete storage;
+	double teardownSeconds = secondsSince(start);
+
+	result.build = buildSeconds*1e9/nodes;
+	result.function = functionSeconds*1e9/nodes;
+	result.teardown = teardownSeconds*1e9/nodes;
+	result.peakBytes = peakBytes - startBytes;
+	return result;
+}
+
+int main(int argc, char** argv) {
+	long long maxNodes = 1000000;
+	string families = "chain,wide,diamond,mlp,example";
+	string storages = "both";
+	string outPath;
+	for(int i=1; i+1<argc; i+=2) {
+		if(strcmp(argv[i], "--max-nodes") == 0) {
+			maxNodes = atof(argv[i+1]);
+		} else if(strcmp(argv[i], "--families") == 0) {
+			families = argv[i+1];
+		} else if(strcmp(argv[i], "--storage") == 0) {
+			storages = argv[i+1];
+		} else if(strcmp(argv[i], "--out") == 0) {
+			outPath = argv[i+1];
+		} else {
+			cerr << "unknown option " << argv[i] << "\n";
+			return 1;
+		}
+	}
+
+	vector<Family> allFamilies = {{"chain", buildChain}, {"wide", buildWide}, {"diamond", buildDiamond}, {"mlp", buildMlp}, {"example", buildExample}};
+	ofstream outFile;
+	if(!outPath.empty()) {
+		outFile.open(outPath);
+	}
+	ostream& out = outPath.empty() ? cout : outFile;
+
+	try {
+		out << "family,storage,size,nodes,inputs,build_ns_per_node,function_ns_per_node,evaluate_ns_per_node,differentiate_ns_per_node,"
+			<< "evaluate_unchecked_ns_per_node,differentiate_unchecked_ns_per_node,teardown_ns_per_node,peak_heap_bytes,"
+			<< "build_allocations,function_allocations,evaluate_allocations,differentiate_allocations\n";
+		for(const Family& family : allFamilies) {
+			if(("," + families + ",").find("," + family.name + ",") == string::npos) {
+				continue;
+			}
+			for(int useGraph=1; useGraph>=0; useGraph--) {
+				if((useGraph == 1 && storages == "nodes") || (useGraph == 0 && storages == "graph")) {
+					continue;
+				}
+				for(long long size=10; size<=maxNodes; size*=10) {
+					Result result = run(family, useGraph == 1, size);
+					out << family.name << "," << (useGraph == 1 ? "graph" : "nodes") << "," << size << "," << result.nodes << "," << result.inputs << ","
+						<< result.build << "," << result.function << "," << result.evaluate << "," << result.differentiate << ","
+						<< result.evaluateUnchecked << "," << result.differentiateUnchecked << "," << result.teardown << "," << result.peakBytes << ","
+						<< result.buildAllocations << "," << result.functionAllocations << "," << result.evaluateAllocations << "," << result.differentiateAllocations << "\n";
+					out.flush();
+				}
+			}
+		}
+	} catch(const char* e) {
+		cerr << e << "\n";
+		return 1;
+	}
+	return 0;
+}
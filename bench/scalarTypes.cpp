@@ -0,0 +1,66 @@
+//throughput of the batched, unchecked path for each scalar type, on a small dense MLP-style scalar graph.
+//prints one CSV row per type
+#include "autoDiff.h"
+#include <iostream>
+#include <chrono>
+
+using namespace std;
+
+template<typename T, typename A>
+double pointsPerSecond(int nInputs, int nHidden, int batchSize, int nBatches) {
+	typedef ad::BasicNode<T,A> Node;
+	vector<Node> x(nInputs), hidden(nHidden), squares(nHidden); //named nodes must outlive the function
+	unsigned seed = 1;
+	for(int j=0; j<nHidden; j++) {
+		vector<Node*> terms;
+		for(int i=0; i<nInputs; i++) {
+			seed = seed*1103515245 + 12345;
+			T weight = T((seed % 2000)/1000.0 - 1.0)/T(nInputs);
+			terms.push_back(&(x[i]*weight));
+		}
+		hidden[j] = tanh(ad::sum(terms));
+		squares[j] = hidden[j]*hidden[j];
+	}
+	vector<Node*> squarePointers;
+	for(Node& square : squares) {
+		squarePointers.push_back(&square);
+	}
+	Node output = ad::sum(squarePointers);
+	vector<Node*> inputs;
+	for(Node& node : x) {
+		inputs.push_back(&node);
+	}
+	ad::BasicFunction<T,A> func(inputs);
+	func.setChecked(false);
+	
+	vector<vector<T>> args(batchSize, vector<T>(nInputs));
+	for(int b=0; b<batchSize; b++) {
+		for(int i=0; i<nInputs; i++) {
+			args[b][i] = T(0.01*(b+i));
+		}
+	}
+	double check(0.0);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for(int r=0; r<nBatches; r++) {
+		check += func.differentiateBatch(args)[0].gradient[0];
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	if(check != check) {
+		cout << "NaN in results\n";
+	}
+	return batchSize*(double)nBatches/seconds;
+}
+
+int main() {
+	try {
+		const int nInputs = 32, nHidden = 32, batchSize = 256, nBatches = 200;
+		cout << "values,derivatives,value_bytes,points_per_second\n";
+		cout << "float,float," << sizeof(float) << "," << pointsPerSecond<float, float>(nInputs, nHidden, batchSize, nBatches) << "\n";
+		cout << "float,double," << sizeof(float) << "," << pointsPerSecond<float, double>(nInputs, nHidden, batchSize, nBatches) << "\n";
+		cout << "double,double," << sizeof(double) << "," << pointsPerSecond<double, double>(nInputs, nHidden, batchSize, nBatches) << "\n";
+		cout << "long double,long double," << sizeof(long double) << "," << pointsPerSecond<long double, long double>(nInputs, nHidden, batchSize, nBatches) << "\n";
+	}
+	catch(const char* err) {
+		cout << "Error: " << err << "\n";
+	}
+}
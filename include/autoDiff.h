@@ -2,4 +2,44 @@
 
 #include "operations.h"
 #include "node.h"
-#include "function.h"
\ No newline at end of file
+#include "graph.h"
+#include "function.h"
+#include "solve.h"
+
+//explicit instantiations of the graph, the operations and the execution engine for each supported scalar type,
+//plus float values with derivatives accumulated in double. they compile every member for every type, which is slow,
+//and a program may only have one of each, so they're opt-in: define AD_INSTANTIATE_ALL in a single source file
+//(src/instantiations.cpp, which the CMake build compiles, checks that everything builds for all the types)
+#ifdef AD_INSTANTIATE_ALL
+#define AD_INSTANTIATE(T, A) \
+	template struct BasicOperation<T,A>; \
+	template struct BasicCustomOperation<T,A>; \
+	template struct BasicScalarOperation<T,A>; \
+	template struct Inherit<T,A>; \
+	template struct Add<T,A>; \
+	template struct Subtract<T,A>; \
+	template struct Multiply<T,A>; \
+	template struct Divide<T,A>; \
+	template struct Log<T,A>; \
+	template struct Exp<T,A>; \
+	template struct LogSumExp<T,A>; \
+	template struct Softmax<T,A>; \
+	template struct Sigmoid<T,A>; \
+	template struct Softplus<T,A>; \
+	template struct Pow<T,A>; \
+	template struct Sqrt<T,A>; \
+	template struct Tanh<T,A>; \
+	template class BasicNode<T,A>; \
+	template class BasicGraph<T,A>; \
+	template class BasicFunction<T,A>; \
+	template struct Solve<T,A>;
+
+namespace ad {
+	AD_INSTANTIATE(float, float)
+	AD_INSTANTIATE(double, double)
+	AD_INSTANTIATE(long double, long double)
+	AD_INSTANTIATE(float, double)
+}
+
+#undef AD_INSTANTIATE
+#endif
@@ -0,0 +1,328 @@
+#pragma once
+
+#include "autoDiff.h"
+#include <pthread.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <string>
+
+namespace ad {
+	//sums a function's value and gradient over a large fixed set of points, split across forked worker processes.
+	//linux (or any POSIX system with process-shared barriers) only.
+	//the workers are forked once, by the constructor, so each gets a copy-on-write view of the compiled function and
+	//the points and only ever reads them. each call to differentiateSum sends the current parameter values (the inputs
+	//listed in parameterInputs, which override those inputs in every point) through shared memory. each worker sums
+	//over its shard with differentiateBatch, and the workers' partial sums are combined with a ring all-reduce in
+	//shared memory: each worker adds in one chunk from its neighbour per step, so the work is evenly spread.
+	//changes to the function or the points after construction aren't seen by the workers.
+	//the parent talks to each worker over a socket, so a worker that dies is noticed (differentiateSum throws, and the
+	//runner can't be used after that) and workers exit if the parent dies.
+	//construct it before starting any threads, since fork only copies the calling thread
+	template<typename T, typename A = T>
+	class BasicDataParallelRunner {
+		public:
+			typedef BasicFunction<T,A> Function;
+			typedef BasicValueAndGradient<T,A> ValueAndGradient;
+
+		private:
+			//at the start of the shared region, followed by the parameters and then one sum buffer per worker
+			struct Control {
+				pthread_barrier_t step; //the workers, between the steps of the all-reduce
+				int failed; //the first worker to fail claims it with an atomic exchange, and only that one writes error
+				char error[256];
+			};
+
+			const Function& function;
+			const std::vector<std::vector<T>>& points;
+			std::vector<int> parameterInputs;
+			int nWorkers;
+			int batchSize;
+			int sumLength; //the value, then the gradient
+
+			void* shared;
+			size_t sharedSize;
+			Control* control;
+			T* parameters;
+			A* sumBuffers;
+			std::vector<pid_t> workers;
+			std::vector<int> sockets; //the parent's end of each worker's socket
+			bool broken; //a worker died, and the others have been killed
+			std::string lastError;
+
+			A* sums(int worker) {
+				return sumBuffers + (size_t)worker*sumLength;
+			}
+			void chunk(int c, int& begin, int& end) {
+				begin = (long long)sumLength*c/nWorkers;
+				end = (long long)sumLength*(c+1)/nWorkers;
+			}
+			void work(int worker, int socket);
+			void killWorkers();
+			void sumShard(int worker, A* sum);
+			void allReduce(int worker);
+
+		public:
+			BasicDataParallelRunner(const Function& function_, const std::vector<std::vector<T>>& points_, int nWorkers_, std::vector<int> parameterInputs_ = std::vector<int>(), int batchSize_ = 256);
+			~BasicDataParallelRunner();
+			BasicDataParallelRunner(const BasicDataParallelRunner&) = delete;
+			BasicDataParallelRunner& operator=(const BasicDataParallelRunner&) = delete;
+
+			//the value and gradient summed over all the points, with the parameter inputs set to parameterValues
+			ValueAndGradient differentiateSum(std::vector<T> parameterValues = std::vector<T>());
+			//what went wrong in a worker, if differentiateSum threw because of it
+			const std::string& error() const {
+				return lastError;
+			}
+	};
+
+	typedef BasicDataParallelRunner<double> DataParallelRunner;
+
+	template<typename T, typename A>
+	BasicDataParallelRunner<T,A>::BasicDataParallelRunner(const Function& function_, const std::vector<std::vector<T>>& points_, int nWorkers_, std::vector<int> parameterInputs_, int batchSize_): function(function_), points(points_), parameterInputs(parameterInputs_), nWorkers(nWorkers_), batchSize(batchSize_), sumLength(function_.inputCount() + 1) {
+		if(nWorkers < 1) {
+			throw "DataParallelRunner requires at least one worker";
+		}
+		if(batchSize < 1) {
+			throw "DataParallelRunner requires batchSize >= 1";
+		}
+		for(int input : parameterInputs) {
+			if(input < 0 || input >= function.inputCount()) {
+				throw "DataParallelRunner was given a parameter input that the function doesn't have";
+			}
+		}
+		for(const std::vector<T>& point : points) {
+			if((int)point.size() != function.inputCount()) {
+				throw "Number of args does not equal required number of inputs";
+			}
+		}
+
+		//each part aligned for any scalar type
+		size_t alignment = alignof(long double);
+		size_t parametersOffset = (sizeof(Control) + alignment - 1)/alignment*alignment;
+		size_t sumsOffset = parametersOffset + (sizeof(T)*parameterInputs.size() + alignment - 1)/alignment*alignment;
+		sharedSize = sumsOffset + sizeof(A)*sumLength*nWorkers;
+		shared = mmap(nullptr, sharedSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if(shared == MAP_FAILED) {
+			throw "DataParallelRunner could not map shared memory";
+		}
+		control = static_cast<Control*>(shared);
+		parameters = reinterpret_cast<T*>(static_cast<char*>(shared) + parametersOffset);
+		sumBuffers = reinterpret_cast<A*>(static_cast<char*>(shared) + sumsOffset);
+		control->failed = 0;
+		broken = false;
+
+		pthread_barrierattr_t attributes;
+		pthread_barrierattr_init(&attributes);
+		pthread_barrierattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+		pthread_barrier_init(&control->step, &attributes, nWorkers);
+		pthread_barrierattr_destroy(&attributes);
+
+		for(int w=0; w<nWorkers; w++) {
+			int pair[2];
+			pid_t pid = -1;
+			bool paired = socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0;
+			if(paired) {
+				pid = fork();
+				if(pid == 0) {
+					//keep only this worker's end, so each end's closing is seen by the other side
+					for(int socket : sockets) {
+						close(socket);
+					}
+					close(pair[0]);
+					work(w, pair[1]);
+					_exit(0); //skip the destructors of everything the parent owns
+				}
+				close(pair[1]);
+			}
+			if(pid < 0) {
+				if(paired) {
+					close(pair[0]);
+				}
+				killWorkers();
+				pthread_barrier_destroy(&control->step);
+				munmap(shared, sharedSize);
+				throw "DataParallelRunner could not start a worker";
+			}
+			workers.push_back(pid);
+			sockets.push_back(pair[0]);
+		}
+	}
+	
+	template<typename T, typename A>
+	void BasicDataParallelRunner<T,A>::killWorkers() {
+		for(pid_t worker : workers) {
+			kill(worker, SIGKILL);
+			waitpid(worker, nullptr, 0);
+		}
+		for(int socket : sockets) {
+			close(socket);
+		}
+		workers.resize(0);
+		sockets.resize(0);
+		broken = true;
+	}
+
+	template<typename T, typename A>
+	BasicDataParallelRunner<T,A>::~BasicDataParallelRunner() {
+		//closing a worker's socket tells it to stop
+		for(int socket : sockets) {
+			close(socket);
+		}
+		for(pid_t worker : workers) {
+			waitpid(worker, nullptr, 0);
+		}
+		//killed workers may have been inside the barrier, and destroying it would wait for them to leave
+		if(!broken) {
+			pthread_barrier_destroy(&control->step);
+		}
+		munmap(shared, sharedSize);
+	}
+
+	template<typename T, typename A>
+	BasicValueAndGradient<T,A> BasicDataParallelRunner<T,A>::differentiateSum(std::vector<T> parameterValues) {
+		if(parameterValues.size() != parameterInputs.size()) {
+			throw "Number of parameter values does not equal number of parameter inputs";
+		}
+		if(broken) {
+			throw "A worker of the DataParallelRunner died, so it can't be used any more. See error()";
+		}
+		std::copy(parameterValues.begin(), parameterValues.end(), parameters);
+		control->failed = 0;
+		
+		//one byte to each worker starts it, and it sends one back when the all-reduce is done.
+		//a dead worker's socket reads as closed; the rest would then wait on the step barrier forever, so they're killed
+		bool lost(false);
+		char go('g');
+		for(int socket : sockets) {
+			lost = lost || send(socket, &go, 1, MSG_NOSIGNAL) != 1;
+		}
+		std::vector<pollfd> waiting;
+		for(int socket : sockets) {
+			waiting.push_back(pollfd{socket, POLLIN, 0});
+		}
+		while(!lost && !waiting.empty()) {
+			if(poll(waiting.data(), waiting.size(), -1) < 0) {
+				lost = errno != EINTR;
+				continue;
+			}
+			for(int i=waiting.size()-1; i>=0; i--) {
+				if(waiting[i].revents == 0) {
+					continue;
+				}
+				char done;
+				if(recv(waiting[i].fd, &done, 1, 0) != 1) {
+					lost = true;
+				}
+				waiting.erase(waiting.begin() + i);
+			}
+		}
+		if(lost) {
+			killWorkers();
+			lastError = "a worker process exited unexpectedly";
+			throw "A worker of the DataParallelRunner died, so it can't be used any more. See error()";
+		}
+		if(control->failed) {
+			lastError = control->error;
+			throw "A worker of the DataParallelRunner failed. See error()";
+		}
+
+		//after the all-reduce every worker's buffer holds the total
+		A* total = sums(0);
+		ValueAndGradient result;
+		result.value = T(total[0]);
+		result.gradient.assign(total + 1, total + sumLength);
+		return result;
+	}
+
+	template<typename T, typename A>
+	void BasicDataParallelRunner<T,A>::work(int worker, int socket) {
+		char command;
+		//stop once the parent closes its end (or dies)
+		while(recv(socket, &command, 1, 0) == 1) {
+			A* sum = sums(worker);
+			const char* error(nullptr);
+			std::string what;
+			try {
+				sumShard(worker, sum);
+			} catch(const char* e) {
+				error = e;
+			} catch(const std::exception& e) {
+				what = e.what();
+				error = what.c_str();
+			} catch(...) {
+				error = "unknown exception";
+			}
+			if(error != nullptr) {
+				//keep going with zeros, so that everyone gets through the barriers
+				std::fill(sum, sum + sumLength, A(0));
+				if(__atomic_exchange_n(&control->failed, 1, __ATOMIC_ACQ_REL) == 0) {
+					strncpy(control->error, error, sizeof(control->error) - 1);
+					control->error[sizeof(control->error) - 1] = '\0';
+				}
+			}
+			allReduce(worker);
+			char done('d');
+			if(send(socket, &done, 1, MSG_NOSIGNAL) != 1) {
+				return;
+			}
+		}
+	}
+
+	//this worker's contiguous share of the points, a batch at a time
+	template<typename T, typename A>
+	void BasicDataParallelRunner<T,A>::sumShard(int worker, A* sum) {
+		std::fill(sum, sum + sumLength, A(0));
+		int nPoints = points.size();
+		int begin = (long long)nPoints*worker/nWorkers;
+		int end = (long long)nPoints*(worker+1)/nWorkers;
+		int nParameters = parameterInputs.size();
+		std::vector<std::vector<T>> batch;
+		for(int first=begin; first<end; first+=batchSize) {
+			int last = std::min(end, first + batchSize);
+			batch.assign(points.begin() + first, points.begin() + last);
+			for(std::vector<T>& args : batch) {
+				for(int p=0; p<nParameters; p++) {
+					args[parameterInputs[p]] = parameters[p];
+				}
+			}
+			std::vector<ValueAndGradient> results = function.differentiateBatch(batch);
+			for(ValueAndGradient& result : results) {
+				sum[0] += result.value;
+				for(int i=1; i<sumLength; i++) {
+					sum[i] += result.gradient[i-1];
+				}
+			}
+		}
+	}
+
+	//the buffers are split into nWorkers chunks. reduce-scatter: at step s worker w adds its left neighbour's partial
+	//sum of chunk w-s-1 into its own, so after nWorkers-1 steps it holds the total of chunk w+1. all-gather: at step s
+	//worker w copies the total of chunk w-s from its left neighbour. every step touches different chunks in neighbouring
+	//workers, so a barrier between steps is all the synchronization needed
+	template<typename T, typename A>
+	void BasicDataParallelRunner<T,A>::allReduce(int worker) {
+		A* own = sums(worker);
+		A* left = sums((worker + nWorkers - 1) % nWorkers);
+		for(int s=0; s<nWorkers-1; s++) {
+			pthread_barrier_wait(&control->step);
+			int begin, end;
+			chunk(((worker - s - 1) % nWorkers + nWorkers) % nWorkers, begin, end);
+			for(int i=begin; i<end; i++) {
+				own[i] += left[i];
+			}
+		}
+		for(int s=0; s<nWorkers-1; s++) {
+			pthread_barrier_wait(&control->step);
+			int begin, end;
+			chunk(((worker - s) % nWorkers + nWorkers) % nWorkers, begin, end);
+			std::copy(left + begin, left + end, own + begin);
+		}
+	}
+};
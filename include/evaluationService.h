@@ -0,0 +1,191 @@
+#pragma once
+
+#include "autoDiff.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace ad {
+	//asynchronous front end to Function::differentiateBatch, for many small concurrent queries against one function.
+	//submit() pushes onto a lock-free queue and returns immediately. a single worker thread collects requests into
+	//micro-batches: a batch is run once it holds maxBatchSize requests, or once its oldest request has waited latencyBudget.
+	//the function must outlive the service, and its graph must not be changed while the service is running.
+	//if the function is checked (the default), a request whose value or gradient isn't finite fails with an exception,
+	//as differentiate would throw; otherwise it gets the NaN or infinity.
+	template<typename T, typename A = T>
+	class BasicEvaluationService {
+		public:
+			typedef BasicFunction<T,A> Function;
+			typedef BasicValueAndGradient<T,A> ValueAndGradient;
+			
+		private:
+			struct Request {
+				std::vector<T> args;
+				std::promise<ValueAndGradient> promise;
+				std::chrono::steady_clock::time_point arrival;
+				Request* next;
+			};
+
+			const Function& function;
+			std::chrono::microseconds latencyBudget;
+			int maxBatchSize;
+
+			std::atomic<Request*> head; //most recently submitted request; the list runs from newest to oldest
+			std::atomic<bool> stopping;
+			std::mutex wakeMutex; //only used to sleep the worker when the queue is empty
+			std::condition_variable wake;
+			std::thread worker;
+
+			void run();
+			void takeSubmitted(std::vector<Request*>& pending);
+			void runBatch(std::vector<Request*>& pending, int batchSize);
+			static bool isFinite(const ValueAndGradient& result);
+
+		public:
+			BasicEvaluationService(const Function& function_, std::chrono::microseconds latencyBudget_ = std::chrono::microseconds(200), int maxBatchSize_ = 256);
+			~BasicEvaluationService();
+
+			std::future<ValueAndGradient> submit(std::vector<T> args);
+	};
+	
+	typedef BasicEvaluationService<double> EvaluationService;
+
+	template<typename T, typename A>
+	BasicEvaluationService<T,A>::BasicEvaluationService(const Function& function_, std::chrono::microseconds latencyBudget_, int maxBatchSize_): function(function_), latencyBudget(latencyBudget_), maxBatchSize(maxBatchSize_), head(nullptr), stopping(false) {
+		if(maxBatchSize < 1) {
+			throw "EvaluationService requires maxBatchSize >= 1";
+		}
+		worker = std::thread(&BasicEvaluationService<T,A>::run, this);
+	}
+
+	//outstanding requests are completed before the worker exits
+	template<typename T, typename A>
+	BasicEvaluationService<T,A>::~BasicEvaluationService() {
+		{
+			std::lock_guard<std::mutex> lock(wakeMutex);
+			stopping = true;
+		}
+		wake.notify_one();
+		worker.join();
+	}
+
+	template<typename T, typename A>
+	std::future<BasicValueAndGradient<T,A>> BasicEvaluationService<T,A>::submit(std::vector<T> args) {
+		if((int)args.size() != function.inputCount()) {
+			throw "Number of args does not equal required number of inputs";
+		}
+		Request* request = new Request;
+		request->args = std::move(args);
+		request->arrival = std::chrono::steady_clock::now();
+		std::future<ValueAndGradient> result = request->promise.get_future();
+
+		Request* previous = head.load(std::memory_order_relaxed);
+		do {
+			request->next = previous;
+		} while(!head.compare_exchange_weak(previous, request, std::memory_order_release, std::memory_order_relaxed));
+
+		//the worker only sleeps on an empty queue, so only the request that makes it non-empty needs to wake it.
+		//taking the mutex orders this against the worker's check-then-wait
+		if(previous == nullptr) {
+			{
+				std::lock_guard<std::mutex> lock(wakeMutex);
+			}
+			wake.notify_one();
+		}
+		return result;
+	}
+
+	//move everything submitted so far onto the back of pending, oldest first
+	template<typename T, typename A>
+	void BasicEvaluationService<T,A>::takeSubmitted(std::vector<Request*>& pending) {
+		Request* request = head.exchange(nullptr, std::memory_order_acquire);
+		int start = pending.size();
+		while(request != nullptr) {
+			pending.push_back(request);
+			request = request->next;
+		}
+		std::reverse(pending.begin() + start, pending.end());
+	}
+
+	template<typename T, typename A>
+	void BasicEvaluationService<T,A>::run() {
+		std::vector<Request*> pending;
+		while(true) {
+			takeSubmitted(pending);
+			if(pending.empty()) {
+				std::unique_lock<std::mutex> lock(wakeMutex);
+				if(stopping && head.load() == nullptr) {
+					return;
+				}
+				wake.wait(lock, [this]{ return stopping || head.load() != nullptr; });
+				continue;
+			}
+
+			//wait for the batch to fill up, but no longer than the oldest request's budget
+			std::chrono::steady_clock::time_point deadline = pending[0]->arrival + latencyBudget;
+			while((int)pending.size() < maxBatchSize && !stopping && std::chrono::steady_clock::now() < deadline) {
+				std::unique_lock<std::mutex> lock(wakeMutex);
+				wake.wait_until(lock, deadline, [this]{ return stopping || head.load() != nullptr; });
+				lock.unlock();
+				takeSubmitted(pending);
+			}
+
+			while(!pending.empty()) {
+				int batchSize = std::min((int)pending.size(), maxBatchSize);
+				runBatch(pending, batchSize);
+				if((int)pending.size() < maxBatchSize) {
+					break; //the rest get a chance to batch with newer requests
+				}
+			}
+		}
+	}
+
+	template<typename T, typename A>
+	bool BasicEvaluationService<T,A>::isFinite(const ValueAndGradient& result) {
+		bool finite = std::isfinite(result.value);
+		for(const A& derivative : result.gradient) {
+			finite = finite && std::isfinite(derivative);
+		}
+		return finite;
+	}
+
+	template<typename T, typename A>
+	void BasicEvaluationService<T,A>::runBatch(std::vector<Request*>& pending, int batchSize) {
+		std::vector<std::vector<T>> args(batchSize);
+		for(int b=0; b<batchSize; b++) {
+			args[b] = std::move(pending[b]->args);
+		}
+		try {
+			BasicNumericalStatus<T,A> status;
+			std::vector<ValueAndGradient> results = function.differentiateBatch(args, &status);
+			for(int b=0; b<batchSize; b++) {
+				//the batch always runs the kernels, so for a checked function a domain error fails its request here instead
+				if(!status.finite && function.isChecked() && !isFinite(results[b])) {
+					pending[b]->promise.set_exception(std::make_exception_ptr("Function evaluated to NaN or infinity"));
+				} else {
+					pending[b]->promise.set_value(std::move(results[b]));
+				}
+			}
+		}
+		catch(...) {
+			//an operation that throws anyway (a custom one, say) throws for the whole batch. rerun the points one at a time,
+			//so that only the requests that actually fail get the exception
+			for(int b=0; b<batchSize; b++) {
+				try {
+					pending[b]->promise.set_value(std::move(function.differentiateBatch({args[b]})[0]));
+				}
+				catch(...) {
+					pending[b]->promise.set_exception(std::current_exception());
+				}
+			}
+		}
+		for(int b=0; b<batchSize; b++) {
+			delete pending[b];
+		}
+		pending.erase(pending.begin(), pending.begin() + batchSize);
+	}
+};
@@ -1,24 +1,147 @@
 #pragma once 
 
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <typeinfo>
+#include "profiler.h"
+
 namespace ad {
+	//result of one differentiation: output value plus gradient with respect to each input
+	template<typename T, typename A = T>
+	struct BasicValueAndGradient {
+		T value;
+		std::vector<A> gradient;
+	};
+
+	//where a NaN or infinity first showed up during a call. in unchecked mode domain errors (like the log of a negative number)
+	//don't throw, they just propagate as NaN or infinity, and this is how they get reported
+	template<typename T, typename A = T>
+	struct BasicNumericalStatus {
+		bool finite; //the output, and the gradient if differentiating, are all finite
+		const BasicNode<T,A>* node; //first node that produced a NaN or infinity from finite inputs (an input node if an arg was bad)
+		const BasicOperation<T,A>* operation; //that node's operation, nullptr for an input node
+		int point; //index of the point in the batch (0 for evaluate and differentiate)
+		bool duringDifferentiation; //whether it was first produced in the backward pass
+		
+		BasicNumericalStatus(): finite(true), node(nullptr), operation(nullptr), point(-1), duringDifferentiation(false) {}
+	};
+
 	//constructor requires that the function's graph is completely built when constructed
 	//alternatively, could allow use to build function further, and then "compile" it (which checks for errors, etc)
-	class Function {
+	//values are computed in T and derivatives accumulated in A (see BasicOperation)
+	template<typename T, typename A>
+	class BasicFunction {
+		public:
+			typedef BasicNode<T,A> Node;
+			typedef BasicOperation<T,A> Operation;
+			typedef BasicValueAndGradient<T,A> ValueAndGradient;
+			typedef BasicNumericalStatus<T,A> NumericalStatus;
+			
 		private:
-			std::vector<Node*> nodes;
+			std::vector<Node*> nodes; //topologically sorted: every node comes after all of its parents
 			std::vector<Node*> inputNodes;
 			Node* outputNode;
+			
+			//compiled tape, indexed like nodes. operations[k] is what runs for node k: usually its own operation, but the head
+			//of a flattened chain gets a copy holding the chain's folded constant, and absorbed nodes (the rest of the chain)
+			//get nullptr, like inputs. the nodes themselves are never changed (see flattenChains)
+			std::vector<Operation*> operations;
+			std::vector<std::unique_ptr<Operation>> foldedOperations; //owns those copies
+			std::vector<std::vector<int>> parentIndices;
+			std::vector<int> inputIndices;
+			int outputIndex;
+			int edgeCount;
+			std::vector<int> absorbed; //in order
+			std::vector<std::vector<int>> absorbedParents; //indexed like absorbed: their own parents, which aren't on the tape
+			
+			//the gradient cone: nodes downstream of an input that requires a gradient. only these get adjoints
+			std::vector<bool> requiresGradientMask; //indexed like inputNodes
+			std::vector<int> adjointSlots; //indexed like nodes: where the node's adjoint is kept, or -1 if outside the cone
+			std::vector<int> coneNodes; //indices of the nodes in the cone, in order
+			std::vector<int> coneBoundary; //nodes outside the cone with a child inside it
+			std::vector<bool> absorbedInCone; //indexed like absorbed
+			
+			std::string name; //what the profiler calls this function
+			bool checked;
+			NumericalStatus lastStatus;
+			
+			bool isAbsorbable(Node* node);
+			void flattenChains();
+			void sortNodes();
+			void checkArgumentCounts();
+			void findGradientCone();
+			void storeOnNodes(const std::vector<T>& values, const std::vector<A>* adjoints);
+			//scalar runs each operation's scalar code instead of its kernel, for checked mode
+			void forwardBatch(const std::vector<std::vector<T>>& args, std::vector<T>& values, bool scalar) const;
+			void backwardBatch(const std::vector<T>& values, std::vector<A>& adjoints, int nPoints, bool scalar, NumericalStatus* watch = nullptr) const;
+			void diagnose(const std::vector<T>& values, int nPoints, bool differentiated, NumericalStatus& status) const;
+			void tangentBatch(const std::vector<T>& values, const std::vector<std::vector<A>>& directions, std::vector<A>& tangents, bool scalar) const;
 
 		public:
-			Function(std::vector<Node*> inputNodes_);
-			double evaluate(std::vector<double> args);
-			std::vector<double> differentiate(std::vector<double> args);
-			int nodeCount() {
-				return nodes.size();
+			BasicFunction(std::vector<Node*> inputNodes_);
+			T evaluate(std::vector<T> args);
+			std::vector<A> differentiate(std::vector<T> args);
+			//batched versions: each element of args is one point. 
+			//these don't touch the state of the nodes, so they may be called concurrently. they always run the kernels,
+			//whatever the mode, and report NaN and infinity through status rather than throwing
+			std::vector<T> evaluateBatch(const std::vector<std::vector<T>>& args, NumericalStatus* status = nullptr) const;
+			std::vector<ValueAndGradient> differentiateBatch(const std::vector<std::vector<T>>& args, NumericalStatus* status = nullptr) const;
+			//forward mode: the derivative of the output along direction (the gradient dotted with it), in one forward pass
+			A directionalDerivative(std::vector<T> args, std::vector<A> direction) const;
+			std::vector<A> directionalDerivativeBatch(const std::vector<std::vector<T>>& args, const std::vector<std::vector<A>>& directions) const;
+			//taylor mode: coefficients 0..order of the output along the line args + t*direction, coefficient k being the
+			//k-th directional derivative over k!. one forward pass, costing O(order^2) per node
+			std::vector<T> taylor(std::vector<T> args, std::vector<T> direction, int order) const;
+			//the same for inputs that are themselves polynomials in t: inputCoefficients[i] holds input i's coefficients,
+			//and all have the same length, one more than the order
+			std::vector<T> taylor(const std::vector<std::vector<T>>& inputCoefficients) const;
+			
+			//checked mode (the default) runs each operation's scalar evaluate/differentiate, which throw on domain errors.
+			//unchecked mode runs the branch-free batched kernels instead, and reports trouble through status().
+			//the mode only applies to the single-point methods (evaluate, differentiate, directionalDerivative and taylor)
+			void setChecked(bool checked_) {
+				checked = checked_;
+			}
+			bool isChecked() const {
+				return checked;
+			}
+			//by default the gradient is taken with respect to every input. inputs that don't require one (fixed data, say)
+			//get 0 in the gradient, and the backward pass skips every node that isn't downstream of an input that does
+			void setRequiresGradient(std::vector<bool> mask);
+			void setRequiresGradient(int input, bool requiresGradient_);
+			bool requiresGradient(int input) const {
+				return requiresGradientMask.at(input);
+			}
+			//status of the last call to evaluate or differentiate
+			NumericalStatus status() const {
+				return lastStatus;
+			}
+			//nodes on the tape: those absorbed into a flattened chain aren't counted
+			int nodeCount() const {
+				return nodes.size() - absorbed.size();
+			}
+			int inputCount() const {
+				return inputNodes.size();
+			}
+			
+			//label for the profiler's output (see profiler.h). defaults to "function <n>" when profiling
+			void setName(std::string name_) {
+				name = name_;
+			}
+			const std::string& getName() const {
+				return name;
 			}
 	};
+	
+	typedef BasicValueAndGradient<double> ValueAndGradient;
+	typedef BasicNumericalStatus<double> NumericalStatus;
+	typedef BasicFunction<double> Function;
+	typedef BasicFunction<float> FloatFunction;
+	typedef BasicFunction<long double> LongDoubleFunction;
 
-	Function::Function(std::vector<Node*> inputNodes_): inputNodes(inputNodes_), outputNode(nullptr) {
+	template<typename T, typename A>
+	BasicFunction<T,A>::BasicFunction(std::vector<Node*> inputNodes_): inputNodes(inputNodes_), outputNode(nullptr), edgeCount(0), name(profiling::nextFunctionName()), checked(true) {
 		int nInputs = inputNodes.size();
 		if(nInputs == 0) {
 			throw "No inputs to function";
@@ -29,21 +152,28 @@ namespace ad {
 			}
 		}
 	
-		//check that we have exactly one terminal Node
+		//collect every node downstream of the inputs
+		std::unordered_set<Node*> visited;
 		for(Node* inputNode : inputNodes) {
-			std::vector<Node*> terminalNodes = inputNode->findTerminalNodes();
-			int nTerminalNodes = terminalNodes.size();
-			if(nTerminalNodes == 0) {
-				throw "At least one input lacks a terminal node. Circularity?";
-			} else if(nTerminalNodes > 1) {
-				throw "More than one terminal node. There must be only one.";
-			} else {
+			if(visited.insert(inputNode).second) {
+				nodes.push_back(inputNode);
+			}
+		}
+		for(int k=0; k<(int)nodes.size(); k++) {
+			for(Node* child : nodes[k]->children) {
+				if(visited.insert(child).second) {
+					nodes.push_back(child);
+				}
+			}
+		}
+		
+		//check that we have exactly one terminal Node
+		for(Node* node : nodes) {
+			if(node->children.size() == 0) {
 				if(outputNode == nullptr) {
-					outputNode = terminalNodes[0];
+					outputNode = node;
 				} else {
-					if(outputNode != terminalNodes[0]) {
-						throw "More than one terminal node. There must be only one.";
-					}
+					throw "More than one terminal node. There must be only one.";
 				}
 			}
 		}
@@ -52,80 +182,656 @@ namespace ad {
 		}
 		
 		//check that there are not any origin nodes of this system not represented by the inputs
-		std::vector<Node*> originNodes = outputNode->findOriginNodes();
+		std::vector<Node*> originNodes;
+		std::vector<Node*> ancestors{outputNode};
+		std::unordered_set<Node*> visitedAncestors{outputNode};
+		for(int k=0; k<(int)ancestors.size(); k++) {
+			if(ancestors[k]->parents.size() == 0) {
+				originNodes.push_back(ancestors[k]);
+			}
+			for(Node* parent : ancestors[k]->parents) {
+				if(visitedAncestors.insert(parent).second) {
+					ancestors.push_back(parent);
+				}
+			}
+		}
 		if(originNodes.size() > inputNodes.size()) {
 			throw "There are more origin nodes in this graph than have been provided as inputs.";
 		} else if(originNodes.size() < inputNodes.size()) {
 			throw "There are fewer origin nodes in this graph than have been provided as inputs.";
 		} else {
+			std::unordered_set<Node*> inputSet(inputNodes.begin(), inputNodes.end());
 			for(Node* originNode : originNodes) {
-				bool found(false);
-				for(Node* inputNode : inputNodes) {
-					if(inputNode == originNode) {
-						found = true;
-						break;
-					}
-				}
-				if(!found) {
+				if(inputSet.count(originNode) == 0) {
 					throw "An origin node of this graph is not represented among the inputs nodes provided.";
 				}
 			}
 		}
+	
+		//should probably also check for circularity directly, by seeing if any nodes have themselves as a parent?
+		//should be impossible if used correctly?
 		
+		sortNodes();
+		checkArgumentCounts();
+		flattenChains();
+		requiresGradientMask.assign(nInputs, true);
+		findGradientCone();
+	}
+	
+	template<typename T, typename A>
+	void BasicFunction<T,A>::setRequiresGradient(std::vector<bool> mask) {
+		if(mask.size() != inputNodes.size()) {
+			throw "Size of requires gradient mask does not equal number of inputs";
+		}
+		requiresGradientMask = mask;
+		findGradientCone();
+	}
+	
+	template<typename T, typename A>
+	void BasicFunction<T,A>::setRequiresGradient(int input, bool requiresGradient_) {
+		if(input < 0 || input >= (int)inputNodes.size()) {
+			throw "No such input";
+		}
+		requiresGradientMask[input] = requiresGradient_;
+		findGradientCone();
+	}
+	
+	//nodes are sorted, so one pass finds everything downstream of the inputs that require gradients.
+	//every node is upstream of the output, so that's exactly the set of nodes on a path from those inputs to the output
+	template<typename T, typename A>
+	void BasicFunction<T,A>::findGradientCone() {
+		int nNodes = nodes.size();
+		std::vector<bool> inCone(nNodes, false);
+		for(int i=0; i<(int)inputNodes.size(); i++) {
+			if(requiresGradientMask[i]) {
+				inCone[inputIndices[i]] = true;
+			}
+		}
+		for(int k=0; k<nNodes; k++) {
+			for(int parentIndex : parentIndices[k]) {
+				if(inCone[parentIndex]) {
+					inCone[k] = true;
+					break;
+				}
+			}
+		}
 		
-		//collect all nodes into std::vector
-		for(Node* inputNode : inputNodes) {
-			nodes.push_back(inputNode);
-			std::vector<Node*> descendantNodes = inputNode->getDescendantNodes();
-			for(Node* descendantNode : descendantNodes) {
-				if(find(nodes.begin(), nodes.end(), descendantNode) == nodes.end()) {
-					nodes.push_back(descendantNode);
+		adjointSlots.assign(nNodes, -1);
+		for(Node* node : nodes) {
+			node->derivative = 0.0;
+		}
+		coneNodes.resize(0);
+		coneBoundary.resize(0);
+		std::vector<bool> onBoundary(nNodes, false);
+		for(int k=0; k<nNodes; k++) {
+			if(!inCone[k]) {
+				continue;
+			}
+			adjointSlots[k] = coneNodes.size();
+			coneNodes.push_back(k);
+			for(int parentIndex : parentIndices[k]) {
+				if(!inCone[parentIndex] && !onBoundary[parentIndex]) {
+					onBoundary[parentIndex] = true;
+					coneBoundary.push_back(parentIndex);
 				}
 			}
 		}
+		
+		//absorbed nodes aren't on the tape, and get no adjoint slot. one's in the cone if any of its own parents is
+		absorbedInCone.assign(absorbed.size(), false);
+		for(int a=0; a<(int)absorbed.size(); a++) {
+			for(int parentIndex : absorbedParents[a]) {
+				if(inCone[parentIndex]) {
+					absorbedInCone[a] = inCone[absorbed[a]] = true;
+					break;
+				}
+			}
+		}
+	}
 	
-		//should probably also check for circularity directly, by seeing if any nodes have themselves as a parent?
-		//should be impossible if used correctly?
+	//done once here, so that the operations needn't check on every call
+	template<typename T, typename A>
+	void BasicFunction<T,A>::checkArgumentCounts() {
+		for(Node* node : nodes) {
+			if(node->operation != nullptr && !node->operation->acceptsArgumentCount(node->parents.size())) {
+				throw "An operation in this graph has the wrong number of inputs";
+			}
+		}
+	}
+	
+	//an Add (or Multiply) node can be folded into its child if the child does the same operation and it's the only child
+	template<typename T, typename A>
+	bool BasicFunction<T,A>::isAbsorbable(Node* node) {
+		if(node->operation == nullptr || node->children.size() != 1) {
+			return false;
+		}
+		Operation* childOperation = node->children[0]->operation;
+		if(typeid(*node->operation) == typeid(Add<T,A>)) {
+			return typeid(*childOperation) == typeid(Add<T,A>);
+		}
+		if(typeid(*node->operation) == typeid(Multiply<T,A>)) {
+			return typeid(*childOperation) == typeid(Multiply<T,A>);
+		}
+		return false;
+	}
+	
+	//chains like a+b+c+d, which the operators build as ((a+b)+c)+d, run on the tape as one wide node.
+	//only the tape changes: the user may still hold any of the nodes, so they keep their links (and get their values, see storeOnNodes)
+	template<typename T, typename A>
+	void BasicFunction<T,A>::flattenChains() {
+		int nNodes = nodes.size();
+		std::vector<bool> isAbsorbed(nNodes);
+		for(int k=0; k<nNodes; k++) {
+			isAbsorbed[k] = isAbsorbable(nodes[k]);
+		}
+		for(int k=0; k<nNodes; k++) {
+			bool absorbs(false);
+			for(int parentIndex : parentIndices[k]) {
+				absorbs = absorbs || isAbsorbed[parentIndex];
+			}
+			if(isAbsorbed[k] || !absorbs) {
+				continue;
+			}
+			Add<T,A>* add = dynamic_cast<Add<T,A>*>(operations[k]);
+			Multiply<T,A>* multiply = dynamic_cast<Multiply<T,A>*>(operations[k]);
+			T constant = add != nullptr ? add->constant : multiply->constant;
+			
+			//walk the parents depth first, in order, descending through absorbed ones
+			std::vector<int> stack(parentIndices[k].rbegin(), parentIndices[k].rend());
+			std::vector<int> flattened;
+			while(!stack.empty()) {
+				int parentIndex = stack.back();
+				stack.pop_back();
+				if(!isAbsorbed[parentIndex]) {
+					flattened.push_back(parentIndex);
+					continue;
+				}
+				if(add != nullptr) {
+					constant += static_cast<Add<T,A>*>(nodes[parentIndex]->operation)->constant;
+				} else {
+					constant *= static_cast<Multiply<T,A>*>(nodes[parentIndex]->operation)->constant;
+				}
+				stack.insert(stack.end(), parentIndices[parentIndex].rbegin(), parentIndices[parentIndex].rend());
+			}
+			parentIndices[k] = flattened;
+			foldedOperations.emplace_back(add != nullptr ? static_cast<Operation*>(new Add<T,A>(constant)) : new Multiply<T,A>(constant));
+			operations[k] = foldedOperations.back().get();
+		}
+		
+		for(int k=0; k<nNodes; k++) {
+			if(isAbsorbed[k]) {
+				absorbed.push_back(k);
+				absorbedParents.push_back(parentIndices[k]);
+				parentIndices[k].resize(0);
+				operations[k] = nullptr;
+			}
+		}
+		edgeCount = 0;
+		for(const std::vector<int>& indices : parentIndices) {
+			edgeCount += indices.size();
+		}
+	}
+	
+	//order nodes so that parents always precede children (Kahn's algorithm), and record the tape for the batched path
+	template<typename T, typename A>
+	void BasicFunction<T,A>::sortNodes() {
+		int nNodes = nodes.size();
+		std::unordered_map<Node*, int> remainingParents;
+		for(Node* node : nodes) {
+			remainingParents[node] = node->parents.size();
+		}
+		std::vector<Node*> sorted;
+		sorted.reserve(nNodes);
+		for(Node* inputNode : inputNodes) {
+			sorted.push_back(inputNode);
+		}
+		for(int k=0; k<(int)sorted.size(); k++) {
+			for(Node* child : sorted[k]->children) {
+				if(--remainingParents[child] == 0) {
+					sorted.push_back(child);
+				}
+			}
+		}
+		if((int)sorted.size() != nNodes) {
+			throw "Could not order the nodes of this graph. Circularity?";
+		}
+		nodes = sorted;
+		
+		std::unordered_map<Node*, int> index;
+		for(int k=0; k<nNodes; k++) {
+			index[nodes[k]] = k;
+		}
+		parentIndices.resize(nNodes);
+		operations.resize(nNodes);
+		edgeCount = 0;
+		for(int k=0; k<nNodes; k++) {
+			for(Node* parent : nodes[k]->parents) {
+				parentIndices[k].push_back(index[parent]);
+			}
+			operations[k] = nodes[k]->operation;
+			edgeCount += parentIndices[k].size();
+		}
+		inputIndices.resize(0);
+		for(Node* inputNode : inputNodes) {
+			inputIndices.push_back(index[inputNode]);
+		}
+		outputIndex = index[outputNode];
 	}
 
-	double Function::evaluate(std::vector<double> args) {
+	template<typename T, typename A>
+	T BasicFunction<T,A>::evaluate(std::vector<T> args) {
 		int nArgs = args.size();
 		int nInputs = inputNodes.size();
 		if(nArgs != nInputs) {
 			throw "Number of args does not equal required number of inputs";
 		}
-	
-		//set all nodes to unevaluated
-		for(Node* node : nodes) {
-			node->evaluated = false;
+		profiling::Call call(name, "evaluate", nodeCount(), edgeCount);
+		lastStatus = NumericalStatus();
+		//checked mode runs the same tape, with each operation's scalar code instead of its kernel
+		std::vector<T> values;
+		forwardBatch({args}, values, checked);
+		storeOnNodes(values, nullptr);
+		if(!std::isfinite(values[outputIndex])) {
+			diagnose(values, 1, false, lastStatus);
 		}
-	
+		return values[outputIndex];
+	}
+
+	template<typename T, typename A>
+	std::vector<A> BasicFunction<T,A>::differentiate(std::vector<T> args) {
+		int nInputs = inputNodes.size();
+		if((int)args.size() != nInputs) {
+			throw "Number of args does not equal required number of inputs";
+		}
+		profiling::Call call(name, "differentiate", nodeCount(), edgeCount);
+		lastStatus = NumericalStatus();
+		std::vector<T> values;
+		forwardBatch({args}, values, checked);
+		std::vector<A> adjoints;
+		backwardBatch(values, adjoints, 1, checked);
+		storeOnNodes(values, &adjoints);
+		
+		std::vector<A> derivatives(nInputs);
+		bool finite = std::isfinite(values[outputIndex]);
 		for(int i=0; i<nInputs; i++) {
-			inputNodes[i]->value = args[i];
-			inputNodes[i]->evaluate();	//recursive evaluation starts here
+			derivatives[i] = nodes[inputIndices[i]]->derivative;
+			finite = finite && std::isfinite(derivatives[i]);
+		}
+		if(!finite) {
+			diagnose(values, 1, true, lastStatus);
+		}
+		return derivatives;
+	}
+	
+	//leave every node as if it had been run on its own, so getValue and getDerivative work on any of them.
+	//absorbed nodes aren't on the tape, so theirs are worked out from their neighbours': values in order from their
+	//parents', and derivatives in reverse from their one child's. derivatives are only set if adjoints are given
+	template<typename T, typename A>
+	void BasicFunction<T,A>::storeOnNodes(const std::vector<T>& values, const std::vector<A>* adjoints) {
+		int nNodes = nodes.size();
+		for(int k=0; k<nNodes; k++) {
+			nodes[k]->value = values[k];
+			if(adjoints != nullptr) {
+				nodes[k]->derivative = adjointSlots[k] >= 0 ? (*adjoints)[adjointSlots[k]] : A(0);
+			}
+		}
+		for(int k : absorbed) {
+			nodes[k]->fillMyValue();
+		}
+		if(adjoints == nullptr) {
+			return;
+		}
+		std::vector<T> inputValues;
+		for(int a=absorbed.size()-1; a>=0; a--) {
+			if(!absorbedInCone[a]) {
+				continue; //nodes outside the cone are left at 0
+			}
+			Node* node = nodes[absorbed[a]];
+			Node* child = node->children[0];
+			inputValues.resize(0);
+			for(Node* parent : child->parents) {
+				inputValues.push_back(parent->value);
+			}
+			std::vector<T> partials = child->operation->differentiateWithOutput(inputValues, child->value);
+			for(int j=0; j<(int)child->parents.size(); j++) {
+				if(child->parents[j] == node) {
+					node->derivative += partials[j] * child->derivative;
+				}
+			}
 		}
-
-		return outputNode->value;
 	}
 
-	std::vector<double> Function::differentiate(std::vector<double> args) {
-		evaluate(args);
+	//values is laid out node by node: the values of node k for all points are contiguous
+	template<typename T, typename A>
+	void BasicFunction<T,A>::forwardBatch(const std::vector<std::vector<T>>& args, std::vector<T>& values, bool scalar) const {
+		int nPoints = args.size();
+		int nNodes = nodes.size();
+		int nInputs = inputNodes.size();
+		for(int b=0; b<nPoints; b++) {
+			if((int)args[b].size() != nInputs) {
+				throw "Number of args does not equal required number of inputs";
+			}
+		}
+		
+		profiling::Call call(name, "forward", nodeCount(), edgeCount);
+		values.assign(nNodes*nPoints, 0.0);
+		if(nPoints == 0) {
+			return;
+		}
+		for(int i=0; i<nInputs; i++) {
+			T* inputValues = &values[inputIndices[i]*nPoints];
+			for(int b=0; b<nPoints; b++) {
+				inputValues[b] = args[b][i];
+			}
+		}
+		
+		std::vector<const T*> x;
+		for(int k=0; k<nNodes; k++) {
+			Operation* operation = operations[k];
+			if(operation == nullptr) {
+				continue;
+			}
+			x.resize(0);
+			for(int parentIndex : parentIndices[k]) {
+				x.push_back(&values[parentIndex*nPoints]);
+			}
+			profiling::Tick start = call.tick();
+			long long allocations = profiling::allocationCount();
+			if(scalar) {
+				operation->Operation::evaluateBatch(x, &values[k*nPoints], nPoints); //the scalar fallback
+			} else {
+				operation->evaluateBatch(x, &values[k*nPoints], nPoints);
+			}
+			call.record(operation, false, nPoints, start, allocations);
+		}
+	}
 	
-		//set all nodes to undifferentiated
-		for(Node* node : nodes) {
-			node->differentiatedParents = false;
-			node->derivative = 0.0;
+	//adjoints are only kept for nodes in the gradient cone, node k's in slot adjointSlots[k].
+	//a kernel's adjoints for parents outside the cone go to a scratch buffer, and are thrown away.
+	//if watch is given, stop at the first node whose kernel turns a parent's adjoint into NaN or infinity, and record it there
+	template<typename T, typename A>
+	void BasicFunction<T,A>::backwardBatch(const std::vector<T>& values, std::vector<A>& adjoints, int nPoints, bool scalar, NumericalStatus* watch) const {
+		int nCone = coneNodes.size();
+		profiling::Call call(name, "backward", nodeCount(), edgeCount);
+		adjoints.assign(nCone*nPoints, 0.0);
+		if(nCone == 0 || nPoints == 0) {
+			return;
+		}
+		for(int b=0; b<nPoints; b++) {
+			adjoints[adjointSlots[outputIndex]*nPoints + b] = 1.0; //derivative of output with respect to itself is 1
+		}
+		std::vector<A> scratchBuffer(coneBoundary.empty() ? 0 : nPoints);
+		A* scratch = scratchBuffer.data(); //only used when there's a boundary, and then it's non-null
+		
+		std::vector<const T*> x;
+		std::vector<A*> xAdjoints;
+		for(int c=nCone-1; c>=0; c--) {
+			int k = coneNodes[c];
+			Operation* operation = operations[k];
+			if(operation == nullptr) {
+				continue;
+			}
+			x.resize(0);
+			xAdjoints.resize(0);
+			for(int parentIndex : parentIndices[k]) {
+				x.push_back(&values[parentIndex*nPoints]);
+				xAdjoints.push_back(adjointSlots[parentIndex] >= 0 ? &adjoints[adjointSlots[parentIndex]*nPoints] : scratch);
+			}
+			profiling::Tick start = call.tick();
+			long long allocations = profiling::allocationCount();
+			if(scalar) {
+				operation->Operation::differentiateBatch(x, &values[k*nPoints], &adjoints[c*nPoints], xAdjoints, nPoints);
+			} else {
+				operation->differentiateBatch(x, &values[k*nPoints], &adjoints[c*nPoints], xAdjoints, nPoints);
+			}
+			call.record(operation, true, nPoints, start, allocations);
+			
+			if(watch != nullptr) {
+				for(A* xAdjoint : xAdjoints) {
+					if(xAdjoint == scratch) {
+						continue;
+					}
+					for(int b=0; b<nPoints; b++) {
+						if(!std::isfinite(xAdjoint[b])) {
+							watch->node = nodes[k];
+							watch->operation = nodes[k]->operation;
+							watch->point = b;
+							watch->duringDifferentiation = true;
+							return;
+						}
+					}
+				}
+			}
+		}
+	}
+	
+	//called once a NaN or infinity has turned up in the results, to find where it came from.
+	//the forward values are all still there. since nodes are sorted, the first non-finite one found is the culprit.
+	//if they're all finite the trouble was in the backward pass, which is rerun watching each node
+	template<typename T, typename A>
+	void BasicFunction<T,A>::diagnose(const std::vector<T>& values, int nPoints, bool differentiated, NumericalStatus& status) const {
+		status.finite = false;
+		int nNodes = nodes.size();
+		for(int k=0; k<nNodes; k++) {
+			for(int b=0; b<nPoints; b++) {
+				if(!std::isfinite(values[k*nPoints + b])) {
+					status.node = nodes[k];
+					status.operation = nodes[k]->operation;
+					status.point = b;
+					status.duringDifferentiation = false;
+					return;
+				}
+			}
+		}
+		if(differentiated) {
+			std::vector<A> adjoints;
+			backwardBatch(values, adjoints, nPoints, false, &status);
+		}
+	}
+	
+	template<typename T, typename A>
+	std::vector<T> BasicFunction<T,A>::evaluateBatch(const std::vector<std::vector<T>>& args, NumericalStatus* status) const {
+		int nPoints = args.size();
+		profiling::Call call(name, "evaluateBatch", nodeCount(), edgeCount);
+		std::vector<T> values;
+		forwardBatch(args, values, false);
+		std::vector<T> outputs(values.begin() + outputIndex*nPoints, values.begin() + (outputIndex+1)*nPoints);
+		
+		if(status != nullptr) {
+			*status = NumericalStatus();
+			for(int b=0; b<nPoints; b++) {
+				if(!std::isfinite(outputs[b])) {
+					diagnose(values, nPoints, false, *status);
+					break;
+				}
+			}
 		}
+		return outputs;
+	}
 	
-		outputNode->derivative = 1.0; //derivative of output with respect to itself is 1
-		outputNode->differentiate(); //recursive differentiation starts here
+	template<typename T, typename A>
+	std::vector<BasicValueAndGradient<T,A>> BasicFunction<T,A>::differentiateBatch(const std::vector<std::vector<T>>& args, NumericalStatus* status) const {
+		int nPoints = args.size();
+		int nInputs = inputNodes.size();
+		profiling::Call call(name, "differentiateBatch", nodeCount(), edgeCount);
+		std::vector<T> values;
+		forwardBatch(args, values, false);
+		std::vector<A> adjoints;
+		backwardBatch(values, adjoints, nPoints, false);
+		
+		bool finite(true);
+		std::vector<ValueAndGradient> results(nPoints);
+		for(int b=0; b<nPoints; b++) {
+			results[b].value = values[outputIndex*nPoints + b];
+			finite = finite && std::isfinite(results[b].value);
+			results[b].gradient.resize(nInputs);
+			for(int i=0; i<nInputs; i++) {
+				int slot = adjointSlots[inputIndices[i]];
+				results[b].gradient[i] = slot >= 0 ? adjoints[slot*nPoints + b] : A(0);
+				finite = finite && std::isfinite(results[b].gradient[i]);
+			}
+		}
+		
+		if(status != nullptr) {
+			*status = NumericalStatus();
+			if(!finite) {
+				diagnose(values, nPoints, true, *status);
+			}
+		}
+		return results;
+	}
 	
+	//tangents is laid out like values. normally each operation's jvpBatch kernel propagates them;
+	//with scalar the partials come from the scalar differentiate, with a unit adjoint
+	template<typename T, typename A>
+	void BasicFunction<T,A>::tangentBatch(const std::vector<T>& values, const std::vector<std::vector<A>>& directions, std::vector<A>& tangents, bool scalar) const {
+		int nPoints = directions.size();
+		int nNodes = nodes.size();
 		int nInputs = inputNodes.size();
-		std::vector<double> derivatives(nInputs);
+		profiling::Call call(name, "tangent", nodeCount(), edgeCount);
+		tangents.assign(nNodes*nPoints, 0.0);
+		if(nPoints == 0) {
+			return;
+		}
+		for(int b=0; b<nPoints; b++) {
+			if((int)directions[b].size() != nInputs) {
+				throw "Size of direction does not equal number of inputs";
+			}
+			for(int i=0; i<nInputs; i++) {
+				tangents[inputIndices[i]*nPoints + b] = directions[b][i];
+			}
+		}
+		
+		std::vector<const T*> x;
+		std::vector<const A*> xTangents;
+		std::vector<A> unit(nPoints, A(1));
+		std::vector<A> partials;
+		std::vector<A*> partialPointers;
+		for(int k=0; k<nNodes; k++) {
+			Operation* operation = operations[k];
+			if(operation == nullptr) {
+				continue;
+			}
+			int nParents = parentIndices[k].size();
+			x.resize(0);
+			xTangents.resize(0);
+			for(int parentIndex : parentIndices[k]) {
+				x.push_back(&values[parentIndex*nPoints]);
+				xTangents.push_back(&tangents[parentIndex*nPoints]);
+			}
+			A* tangent = &tangents[k*nPoints];
+			profiling::Tick start = call.tick();
+			long long allocations = profiling::allocationCount();
+			if(scalar) {
+				partials.assign(nParents*nPoints, A(0));
+				partialPointers.resize(nParents);
+				for(int j=0; j<nParents; j++) {
+					partialPointers[j] = &partials[j*nPoints];
+				}
+				operation->Operation::differentiateBatch(x, &values[k*nPoints], &unit[0], partialPointers, nPoints);
+				for(int j=0; j<nParents; j++) {
+					for(int b=0; b<nPoints; b++) {
+						tangent[b] += partials[j*nPoints + b] * xTangents[j][b];
+					}
+				}
+			} else {
+				operation->jvpBatch(x, &values[k*nPoints], xTangents, tangent, nPoints);
+			}
+			call.record(operation, false, nPoints, start, allocations);
+		}
+	}
+	
+	template<typename T, typename A>
+	A BasicFunction<T,A>::directionalDerivative(std::vector<T> args, std::vector<A> direction) const {
+		profiling::Call call(name, "directionalDerivative", nodeCount(), edgeCount);
+		std::vector<T> values;
+		forwardBatch({args}, values, checked);
+		std::vector<A> tangents;
+		tangentBatch(values, {direction}, tangents, checked);
+		return tangents[outputIndex];
+	}
+	
+	template<typename T, typename A>
+	std::vector<A> BasicFunction<T,A>::directionalDerivativeBatch(const std::vector<std::vector<T>>& args, const std::vector<std::vector<A>>& directions) const {
+		int nPoints = args.size();
+		if((int)directions.size() != nPoints) {
+			throw "Number of directions does not equal number of points";
+		}
+		profiling::Call call(name, "directionalDerivativeBatch", nodeCount(), edgeCount);
+		std::vector<T> values;
+		forwardBatch(args, values, false);
+		std::vector<A> tangents;
+		tangentBatch(values, directions, tangents, false);
+		return std::vector<A>(tangents.begin() + outputIndex*nPoints, tangents.begin() + (outputIndex+1)*nPoints);
+	}
+	
+	template<typename T, typename A>
+	std::vector<T> BasicFunction<T,A>::taylor(std::vector<T> args, std::vector<T> direction, int order) const {
+		int nInputs = inputNodes.size();
+		if((int)args.size() != nInputs) {
+			throw "Number of args does not equal required number of inputs";
+		}
+		if((int)direction.size() != nInputs) {
+			throw "Size of direction does not equal number of inputs";
+		}
+		if(order < 0) {
+			throw "Taylor order must be non-negative";
+		}
+		std::vector<std::vector<T>> inputCoefficients(nInputs, std::vector<T>(order+1, T(0)));
 		for(int i=0; i<nInputs; i++) {
-			derivatives[i] = inputNodes[i]->derivative;
-	 	}
+			inputCoefficients[i][0] = args[i];
+			if(order > 0) {
+				inputCoefficients[i][1] = direction[i];
+			}
+		}
+		return taylor(inputCoefficients);
+	}
 	
-		return derivatives;
+	//coefficients is laid out node by node, order+1 for each. the value (coefficient 0) comes from the operation's
+	//evaluate, so checked mode still checks the point itself, and then its taylor rule fills in the rest
+	template<typename T, typename A>
+	std::vector<T> BasicFunction<T,A>::taylor(const std::vector<std::vector<T>>& inputCoefficients) const {
+		int nNodes = nodes.size();
+		int nInputs = inputNodes.size();
+		if((int)inputCoefficients.size() != nInputs) {
+			throw "Number of args does not equal required number of inputs";
+		}
+		int length = inputCoefficients[0].size();
+		for(const std::vector<T>& coefficients : inputCoefficients) {
+			if((int)coefficients.size() != length || length == 0) {
+				throw "Taylor coefficients of the inputs must all have the same, non-zero length";
+			}
+		}
+		int order = length - 1;
+		
+		profiling::Call call(name, "taylor", nodeCount(), edgeCount);
+		std::vector<T> coefficients(nNodes*length, T(0));
+		for(int i=0; i<nInputs; i++) {
+			std::copy(inputCoefficients[i].begin(), inputCoefficients[i].end(), coefficients.begin() + inputIndices[i]*length);
+		}
+		
+		std::vector<const T*> x;
+		for(int k=0; k<nNodes; k++) {
+			Operation* operation = operations[k];
+			if(operation == nullptr) {
+				continue;
+			}
+			x.resize(0);
+			for(int parentIndex : parentIndices[k]) {
+				x.push_back(&coefficients[parentIndex*length]);
+			}
+			T* output = &coefficients[k*length];
+			profiling::Tick start = call.tick();
+			long long allocations = profiling::allocationCount();
+			//a batch of one point reads just the parents' values
+			if(checked) {
+				operation->Operation::evaluateBatch(x, output, 1);
+			} else {
+				operation->evaluateBatch(x, output, 1);
+			}
+			operation->taylor(x, output, order);
+			call.record(operation, false, 1, start, allocations);
+		}
+		return std::vector<T>(coefficients.begin() + outputIndex*length, coefficients.begin() + (outputIndex+1)*length);
 	}
-};
\ No newline at end of file
+};
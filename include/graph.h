@@ -0,0 +1,88 @@
+#pragma once
+
+#include <new>
+
+namespace ad {
+	//owns the nodes of a graph, allocated in blocks. operators applied to a graph's nodes allocate their results in the
+	//same graph, so the whole graph is torn down in one linear pass, with none of the unlinking that free-standing nodes do.
+	//clear() does the same but keeps the blocks, which makes repeatedly building and discarding a graph cheap.
+	//hold graph nodes by reference (ad::Node& y = x*2). nodes outside the graph can't be built on them, and operations
+	//can't mix nodes of different graphs or graph nodes with free-standing ones: those throw, since a graph doesn't
+	//unlink its nodes from anything outside it when it's torn down.
+	//clearing or destroying the graph invalidates its nodes, and any Function built on them
+	template<typename T, typename A>
+	class BasicGraph {
+		public:
+			typedef BasicNode<T,A> Node;
+			
+			BasicGraph(): nNodes(0) {}
+			~BasicGraph();
+			BasicGraph(const BasicGraph&) = delete;
+			BasicGraph& operator=(const BasicGraph&) = delete;
+			
+			Node& input() {
+				return *construct();
+			}
+			void clear();
+			int nodeCount() const {
+				return nNodes;
+			}
+		
+		private:
+			static const int blockSize = 1024;
+			std::vector<Node*> blocks;
+			int nNodes;
+			
+			Node* allocate();
+			Node* construct();
+			Node* construct(std::vector<Node*>& parents, BasicOperation<T,A>* operation);
+			
+			friend class BasicNode<T,A>;
+			template<typename U, typename B> friend BasicNode<U,B>& makeNode(std::vector<BasicNode<U,B>*> parents, BasicOperation<U,B>* operation);
+	};
+	
+	typedef BasicGraph<double> Graph;
+	typedef BasicGraph<float> FloatGraph;
+	typedef BasicGraph<long double> LongDoubleGraph;
+	
+	template<typename T, typename A>
+	BasicGraph<T,A>::~BasicGraph() {
+		clear();
+		for(Node* block : blocks) {
+			::operator delete(block);
+		}
+	}
+	
+	template<typename T, typename A>
+	void BasicGraph<T,A>::clear() {
+		for(int i=0; i<nNodes; i++) {
+			blocks[i/blockSize][i%blockSize].~Node();
+		}
+		nNodes = 0;
+	}
+	
+	//storage for the next node, reusing blocks left over from before a clear()
+	template<typename T, typename A>
+	BasicNode<T,A>* BasicGraph<T,A>::allocate() {
+		if(nNodes == (int)blocks.size()*blockSize) {
+			blocks.push_back(static_cast<Node*>(::operator new(blockSize*sizeof(Node))));
+		}
+		Node* node = &blocks[nNodes/blockSize][nNodes%blockSize];
+		nNodes++;
+		return node;
+	}
+	
+	template<typename T, typename A>
+	BasicNode<T,A>* BasicGraph<T,A>::construct() {
+		Node* node = new (allocate()) Node;
+		node->graph = this;
+		return node;
+	}
+	
+	template<typename T, typename A>
+	BasicNode<T,A>* BasicGraph<T,A>::construct(std::vector<Node*>& parents, BasicOperation<T,A>* operation) {
+		Node* node = new (allocate()) Node(parents, operation);
+		node->graph = this;
+		return node;
+	}
+};
@@ -1,73 +1,72 @@
 #pragma once
 
 #include <algorithm>
+#include <unordered_set>
 
 namespace ad {
-	class Node {
+	template<typename T, typename A = T> class BasicFunction;
+	template<typename T, typename A = T> class BasicGraph;
+
+	template<typename T, typename A = T>
+	class BasicNode {
 	public:
-		Node();
-		Node(Node& parent);
-		~Node();
+		typedef T Scalar;
+		typedef A Accumulator;
+		typedef BasicOperation<T,A> Operation;
+		
+		BasicNode();
+		BasicNode(BasicNode& parent);
+		~BasicNode();
 		
-		Node& operator= (Node& node);
+		BasicNode& operator= (BasicNode& node);
 	
-		double getValue();
-		double getDerivative();
+		T getValue();
+		A getDerivative();
 		
-		friend Node& operator+(Node& parent1, Node& parent2);
-		friend Node& operator+(Node& parent, double x);
-		friend Node& operator-(Node& parent1, Node& parent2);
-		friend Node& operator-(Node& parent, double x);
-		friend Node& operator-(double x, Node& parent);
-		friend Node& operator*(Node& parent1, Node& parent2);
-		friend Node& operator*(Node& parent, double x);
-		friend Node& operator/(Node& parent1, Node& parent2);
-		friend Node& operator/(Node& parent, double x);
-		friend Node& operator/(double x, Node& parent);
-		friend Node& log(Node& parent, double base);
-		friend Node& exp(Node& parent);
+		//every operator and function that builds a node goes through this
+		template<typename U, typename B> friend BasicNode<U,B>& makeNode(std::vector<BasicNode<U,B>*> parents, BasicOperation<U,B>* operation);
 		
-		void operator+=(Node& node);
-		void operator+=(double x);
-		void operator-=(Node& node);
-		void operator-=(double x);
-		void operator*=(Node& node);
-		void operator*=(double x);
-		void operator/=(Node& node);
-		void operator/=(double x);
+		void operator+=(BasicNode& node);
+		void operator+=(T x);
+		void operator-=(BasicNode& node);
+		void operator-=(T x);
+		void operator*=(BasicNode& node);
+		void operator*=(T x);
+		void operator/=(BasicNode& node);
+		void operator/=(T x);
 		
-		friend class Function;
+		friend class BasicFunction<T,A>;
+		friend class BasicGraph<T,A>;
 	
 	private:
 		Operation* operation;
-		double value;
-		double derivative;
-		std::vector<Node*> parents;
-		std::vector<Node*> children;
-		bool evaluated;
-		bool differentiatedParents;
+		T value;
+		A derivative;
+		std::vector<BasicNode*> parents;
+		std::vector<BasicNode*> children;
 		bool dynamicallyAllocated;
+		BasicGraph<T,A>* graph; //the graph that owns this node, if any
 		
-		Node(Node& parent, Operation* operation);
-		Node(Node& parent1, Node& parent2, Operation* operation);
-		Node(std::vector<Node*>& parents, Operation* operation);
+		BasicNode(BasicNode& parent, Operation* operation);
+		BasicNode(BasicNode& parent1, BasicNode& parent2, Operation* operation);
+		BasicNode(std::vector<BasicNode*>& parents, Operation* operation);
 		
-		void evaluate();
-		void differentiate();
 		void fillMyValue();
 		void updateParentDerivatives();
-		std::vector<Node*> getDescendantNodes();
-		std::vector<Node*> findTerminalNodes();
-		std::vector<Node*> findOriginNodes();
-		void setParent(Node& node);
-		bool nodeIsAncestor(Node* node);
+		void setParent(BasicNode& node);
+		bool nodeIsAncestor(BasicNode* node);
 		void unlink();
 		void deleteDynamicallyAllocatedAncestors();
 		void replaceWithDynamicCopy();
-		void replaceNodeWithSelf(Node& node);
+		void replaceNodeWithSelf(BasicNode& node);
 	};
 	
-	void Node::replaceNodeWithSelf(Node& node) {
+	typedef BasicNode<double> Node;
+	typedef BasicNode<float> FloatNode;
+	typedef BasicNode<long double> LongDoubleNode;
+	
+	template<typename T, typename A>
+	void BasicNode<T,A>::replaceNodeWithSelf(BasicNode& node) {
 		if(this == &node) {
 			return;
 		}
@@ -78,7 +77,7 @@ namespace ad {
 		operation = node.operation;
 		node.operation = nullptr; //so it's not deleted when node is deleted
 		parents = node.parents;
-		for(Node* parent : parents) {
+		for(BasicNode* parent : parents) {
 			int nParentsChildren = parent->children.size();
 			for(int i=0; i<nParentsChildren; i++) {
 				if(parent->children[i] == &node) {
@@ -87,7 +86,7 @@ namespace ad {
 			}
 		}
 		children = node.children;
-		for(Node* child : children) {
+		for(BasicNode* child : children) {
 			int nChildrensParents = child->parents.size();
 			for(int i=0; i<nChildrensParents; i++) {
 				if(child->parents[i] == &node) {
@@ -100,10 +99,14 @@ namespace ad {
 	}
 	
 	//assignment operator
-	Node& Node::operator= (Node& node) {
+	template<typename T, typename A>
+	BasicNode<T,A>& BasicNode<T,A>::operator= (BasicNode& node) {
 		if(this == &node) {
 			return *this;
 		}
+		if(node.graph != graph) {
+			throw "Can't assign a node from a graph to a node outside it";
+		}
 		
 		//if the assignment operator is being called, then this node probably already exists
 		//if it has any connections at all to the system now, then make a copy of it on the heap
@@ -111,6 +114,8 @@ namespace ad {
 			replaceWithDynamicCopy();
 		}
 				
+		//this node is disconnected now, so taking over a freshly made node (the usual case, as in s += x) can't
+		//close a cycle. only check when becoming the child of an existing named node
 		if(node.dynamicallyAllocated) {
 			replaceNodeWithSelf(node);
 		} else {
@@ -118,105 +123,134 @@ namespace ad {
 			if(operation != nullptr) {
 				delete operation;
 			}
-			operation = new Inherit;
+			operation = new Inherit<T,A>;
 			parents.resize(0);
 			children.resize(0);
 			setParent(node);
-		}
-		
-		if(nodeIsAncestor(this)) {
-			throw "invalid graph: node is an ancestor of itself";
+			if(nodeIsAncestor(this)) {
+				throw "invalid graph: node is an ancestor of itself";
+			}
 		}
 		
 		return *this;
 	}
 
 	//base constructor used for input nodes
-	Node::Node(): operation(nullptr), value(0), derivative(0), evaluated(false), differentiatedParents(false), dynamicallyAllocated(false) {}
+	template<typename T, typename A>
+	BasicNode<T,A>::BasicNode(): operation(nullptr), value(0), derivative(0), dynamicallyAllocated(false), graph(nullptr) {}
 
 	//this is the copy constructor. 
 	//if the node passed in is dynamicallyAllocated (not in scope - only possible when creating nodes with operators), replace that node with self
 	//else, inherit it as a parent
-	Node::Node(Node& node): value(0), derivative(0), evaluated(false), differentiatedParents(false), dynamicallyAllocated(false) {
+	template<typename T, typename A>
+	BasicNode<T,A>::BasicNode(BasicNode& node): value(0), derivative(0), dynamicallyAllocated(false), graph(nullptr) {
+		if(node.graph != nullptr) {
+			throw "Can't build a free-standing node on a graph's node. Hold it by reference instead";
+		}
 		if(node.dynamicallyAllocated) {
 			replaceNodeWithSelf(node);
 		} else {
-			operation = new Inherit;
+			operation = new Inherit<T,A>;
 			setParent(node);
 		}
 	}
 
-	Node::Node(Node& parent, Operation* operation_): operation(operation_), value(0), derivative(0), evaluated(false), differentiatedParents(false), dynamicallyAllocated(false) {
+	template<typename T, typename A>
+	BasicNode<T,A>::BasicNode(BasicNode& parent, Operation* operation_): operation(operation_), value(0), derivative(0), dynamicallyAllocated(false), graph(nullptr) {
 		setParent(parent);
 	}
 
-	Node::Node(Node& parent1, Node& parent2, Operation* operation_): operation(operation_), value(0), derivative(0), evaluated(false), differentiatedParents(false), dynamicallyAllocated(false) {
+	template<typename T, typename A>
+	BasicNode<T,A>::BasicNode(BasicNode& parent1, BasicNode& parent2, Operation* operation_): operation(operation_), value(0), derivative(0), dynamicallyAllocated(false), graph(nullptr) {
 		setParent(parent1);
 		setParent(parent2);
 	}
 
-	Node::Node(std::vector<Node*>& parents, Operation* operation_): operation(operation_), value(0), derivative(0), evaluated(false), differentiatedParents(false), dynamicallyAllocated(false) {
+	template<typename T, typename A>
+	BasicNode<T,A>::BasicNode(std::vector<BasicNode*>& parents, Operation* operation_): operation(operation_), value(0), derivative(0), dynamicallyAllocated(false), graph(nullptr) {
 		int nParents = parents.size();
 		for(int i=0; i<nParents; i++) {
 			setParent(*parents[i]);
 		}
 	}
 	
-	void Node::unlink() {
+	template<typename T, typename A>
+	void BasicNode<T,A>::unlink() {
 		//remove self from each parent's children vector
-		for(Node* parent : parents) {
-			std::vector<Node*> newChildVec;
-			for(Node* child : parent->children) {
-				if(child != this) {
-					newChildVec.push_back(child);
-				}
-			}
-			parent->children = newChildVec;
+		for(BasicNode* parent : parents) {
+			parent->children.erase(std::remove(parent->children.begin(), parent->children.end(), this), parent->children.end());
 		}
 		parents.resize(0);
 		
 		//remove self from each child's parent vector
-		for(Node* child : children) {
-			std::vector<Node*> newParentVec;
-			for(Node* parent : child->parents) {
-				if(parent != this) {
-					newParentVec.push_back(parent);
-				}
-			}
-			child->parents = newParentVec;
+		for(BasicNode* child : children) {
+			child->parents.erase(std::remove(child->parents.begin(), child->parents.end(), this), child->parents.end());
 		}
 		children.resize(0);
 	}
 	
-	void Node::deleteDynamicallyAllocatedAncestors() {
-		//go through each parent and delete if dynamically allocated
-		//since the parent vector will generally be resized when parent is deleted (due to unlink()), we need to iterate carefully through this!
-		while(true) {
-			bool hasDynamicallyAllocatedParent(false);
-			for(Node* parent : parents) {
-				if(parent->dynamicallyAllocated){
-					hasDynamicallyAllocatedParent = true;
-					delete parent; //calls destructor first, which will in turn delete any dynamically allocated ancestors of parent
-					break;
+	//delete the dynamically allocated nodes upstream of this one: nobody else owns them.
+	//they're all found first, then each surviving neighbour drops its links to them in a single pass
+	//(an input shared by a million doomed nodes is scanned once, not a million times), and only then are they deleted,
+	//so the deletes don't cascade or recurse down long chains. this node ends up unlinked too
+	template<typename T, typename A>
+	void BasicNode<T,A>::deleteDynamicallyAllocatedAncestors() {
+		std::vector<BasicNode*> doomed;
+		std::unordered_set<BasicNode*> queued;
+		for(int k=-1; k<(int)doomed.size(); k++) {
+			BasicNode* node = k < 0 ? this : doomed[k];
+			for(BasicNode* parent : node->parents) {
+				if(parent->dynamicallyAllocated && queued.insert(parent).second) {
+					doomed.push_back(parent);
 				}
 			}
-			if(!hasDynamicallyAllocatedParent) {
-				return;
+		}
+		if(doomed.empty()) {
+			return;
+		}
+		
+		queued.insert(this);
+		doomed.push_back(this);
+		std::unordered_set<BasicNode*> survivors;
+		for(BasicNode* node : doomed) {
+			for(BasicNode* parent : node->parents) {
+				if(queued.count(parent) == 0 && survivors.insert(parent).second) {
+					parent->children.erase(std::remove_if(parent->children.begin(), parent->children.end(), [&](BasicNode* child){ return queued.count(child) > 0; }), parent->children.end());
+				}
+			}
+			for(BasicNode* child : node->children) {
+				if(queued.count(child) == 0 && survivors.insert(child).second) {
+					child->parents.erase(std::remove_if(child->parents.begin(), child->parents.end(), [&](BasicNode* parent){ return queued.count(parent) > 0; }), child->parents.end());
+				}
 			}
 		}
+		doomed.pop_back();
+		parents.resize(0);
+		children.resize(0);
+		for(BasicNode* node : doomed) {
+			node->parents.resize(0);
+			node->children.resize(0);
+			delete node;
+		}
 	}
 	
-	//replace this node with a copy of it on the heap. 
+	//replace this node with a copy of it on the heap (or in this node's graph). 
 	//the copy takes any connections that this one had, effectively disconnecting this node from the system
-	void Node::replaceWithDynamicCopy() {
-		Node* node = new Node;
+	template<typename T, typename A>
+	void BasicNode<T,A>::replaceWithDynamicCopy() {
+		BasicNode* node;
+		if(graph != nullptr) {
+			node = graph->construct();
+		} else {
+			node = new BasicNode;
+			node->dynamicallyAllocated = true;
+		}
 		node->operation = this->operation;
-		node->dynamicallyAllocated = true;
-		for(Node* parent : this->parents) {
+		for(BasicNode* parent : this->parents) {
 			node->setParent(*parent);	
 		}
 		node->children = this->children;
-		for(Node* child : this->children) {
+		for(BasicNode* child : this->children) {
 			int nChildParents = child->parents.size();
 			for(int i=0; i<nChildParents; i++) {
 				if(child->parents[i] == this) {
@@ -229,7 +263,13 @@ namespace ad {
 		this->unlink();
 	}
 	
-	Node::~Node() {
+	template<typename T, typename A>
+	BasicNode<T,A>::~BasicNode() {
+		if(graph != nullptr) {
+			//the graph tears all of its nodes down at once, so there are no neighbours to fix up
+			delete operation;
+			return;
+		}
 		deleteDynamicallyAllocatedAncestors();
 		if(operation != nullptr) {
 			delete operation;
@@ -238,301 +278,311 @@ namespace ad {
 		unlink();
 	}
 
-	double Node::getValue() {
+	template<typename T, typename A>
+	T BasicNode<T,A>::getValue() {
 		return value;
 	}
 
-	double Node::getDerivative() {
+	template<typename T, typename A>
+	A BasicNode<T,A>::getDerivative() {
 		return derivative;
 	}
 
-	void Node::evaluate() {
-		if(evaluated) {
-			return;
-		}
-	
-		//don't go if not all parents evaluated
-		int nParents = parents.size();
-		for(int i=0; i<nParents; i++) {
-			if(!parents[i]->evaluated) {
-				return;
-			}
-		}
-	
-		fillMyValue();
-		evaluated = true;
-	
-		int nChildren = children.size();
-		for(int i=0; i<nChildren; i++) {
-			children[i]->evaluate();
-		}
-	
-		return;
-	}
-
-	void Node::differentiate() {
-		if(differentiatedParents) {
-			return;
-		}
-	
-		//don't go if not all children differentiated their parents
-		int nChildren = children.size();
-		for(int i=0; i<nChildren; i++) {
-			if(!children[i]->differentiatedParents) {
-				return;
-			}
-		}
-	
-		updateParentDerivatives();
-		differentiatedParents = true;
-	
-		int nParents = parents.size();
-		for(int i=0; i<nParents; i++) {
-			parents[i]->differentiate();
-		}
-	
-		return;
-	}
-
-	void Node::fillMyValue() {
+	template<typename T, typename A>
+	void BasicNode<T,A>::fillMyValue() {
 		if(operation == nullptr) {
 			return;
 		}
 		int nParents = parents.size();
-		std::vector<double> inputValues(nParents);
+		std::vector<T> inputValues(nParents);
 		for(int i=0; i<nParents; i++) {
 			inputValues[i] = parents[i]->value;
 		}
 		value = operation->evaluate(inputValues);
 	}
 
-	void Node::updateParentDerivatives() {
+	template<typename T, typename A>
+	void BasicNode<T,A>::updateParentDerivatives() {
 		if(operation == nullptr) {
 			return;
 		}
 		int nParents = parents.size();
-		std::vector<double> inputValues(nParents);
+		std::vector<T> inputValues(nParents);
 		for(int i=0; i<nParents; i++) {
 			inputValues[i] = parents[i]->value;
 		}
-		std::vector<double> derivatives = operation->differentiate(inputValues);
+		std::vector<T> derivatives = operation->differentiateWithOutput(inputValues, value);
 		for(int i=0; i<nParents; i++) {
 			parents[i]->derivative += derivatives[i] * derivative;
 		}
 	}
 
-	std::vector<Node*> Node::getDescendantNodes() {
-		std::vector<Node*> descendantNodes;
-		int nChildren = children.size();
-		if(nChildren == 0) {
-			return descendantNodes;
-		}
-		for(int i=0; i<nChildren; i++) {
-			Node* child = children[i];
-			descendantNodes.push_back(child);
-			std::vector<Node*> childDescendants = child->getDescendantNodes(); //recursive
-			int nChildDescendants = childDescendants.size();
-			//put in descendantNodes if not in there yet
-			for(int j=0; j<nChildDescendants; j++) {
-				if(find(descendantNodes.begin(), descendantNodes.end(), childDescendants[j]) == descendantNodes.end()) {
-					descendantNodes.push_back(childDescendants[j]);
+	template<typename T, typename A>
+	bool BasicNode<T,A>::nodeIsAncestor(BasicNode* node) {
+		//iterative, visiting each ancestor once, so deep chains and shared subgraphs are fine
+		std::vector<BasicNode*> ancestors(parents);
+		std::unordered_set<BasicNode*> visited(parents.begin(), parents.end());
+		for(int k=0; k<(int)ancestors.size(); k++) {
+			if(ancestors[k] == node) {
+				return true;
+			}
+			for(BasicNode* parent : ancestors[k]->parents) {
+				if(visited.insert(parent).second) {
+					ancestors.push_back(parent);
 				}
 			}
 		}
-		return descendantNodes;
+		return false;
 	}
 
-	std::vector<Node*> Node::findTerminalNodes() {
-		std::vector<Node*> terminalNodes;
-		int nChildren = children.size();
-		if(nChildren == 0) {
-			terminalNodes.push_back(this);
-			return terminalNodes;
-		} else {
-			for(int i=0; i<nChildren; i++) {
-				std::vector<Node*> childterminalNodes = children[i]->findTerminalNodes(); //recursive
-				int nChildterminalNodes = childterminalNodes.size();
-				//put in terminalNodes if not in there yet
-				for(int j=0; j<nChildterminalNodes; j++) {
-					if(find(terminalNodes.begin(), terminalNodes.end(), childterminalNodes[j]) == terminalNodes.end()) {
-						terminalNodes.push_back(childterminalNodes[j]);
-					}
-				}
-			}
-		}
-		return terminalNodes;
+	template<typename T, typename A>
+	void BasicNode<T,A>::setParent(BasicNode& node) {
+		parents.push_back(&node);
+		node.children.push_back(this);
 	}
 
-	std::vector<Node*> Node::findOriginNodes() {
-		std::vector<Node*> originNodes;
-		int nParents = parents.size();
-		if(nParents == 0) {
-			originNodes.push_back(this);
-			return originNodes;
-		} else {
-			for(int i=0; i<nParents; i++) {
-				std::vector<Node*> parentOriginNodes = parents[i]->findOriginNodes(); //recursive
-				int nParentOriginNodes = parentOriginNodes.size();
-				//put in originNodes if not in there yet
-				for(int j=0; j<nParentOriginNodes; j++) {
-					if(find(originNodes.begin(), originNodes.end(), parentOriginNodes[j]) == originNodes.end()) {
-						originNodes.push_back(parentOriginNodes[j]);
-					}
-				}
-			}
-		}
-		return originNodes;
+
+	template<typename T, typename A>
+	void BasicNode<T,A>::operator+=(BasicNode& node) {
+		*this = *this + node;
 	}
 
-	bool Node::nodeIsAncestor(Node* node) {
-		int nParents = parents.size();
-		if(nParents == 0) {
-			return false;
-		}
-		for(int i=0; i<nParents; i++) {
-			if(parents[i] == node) {
-				return true;
-			}
-		}
-		for(int i=0; i<nParents; i++) {
-			if(parents[i]->nodeIsAncestor(node)) {
-				return true;
-			}
-		}
-		return false;
+	template<typename T, typename A>
+	void BasicNode<T,A>::operator+=(T x) {
+		*this = *this + x;
 	}
 
-	void Node::setParent(Node& node) {
-		parents.push_back(&node);
-		node.children.push_back(this);
+	template<typename T, typename A>
+	void BasicNode<T,A>::operator-=(BasicNode& node) {
+		*this = *this - node;
 	}
 
-	Node& operator+(Node& parent1, Node& parent2) {
-		Operation* op = new Add();
-		Node* node = new Node(parent1, parent2, op);
-		node->dynamicallyAllocated = true;
-		return *node;
-	};
+	template<typename T, typename A>
+	void BasicNode<T,A>::operator-=(T x) {
+		*this = *this - x;
+	}
 
-	Node& operator+(Node& parent, double x) {
-		Operation* op = new Add(x);
-		Node* node = new Node(parent, op);
-		node->dynamicallyAllocated = true;
-		return *node;
-	};
+	template<typename T, typename A>
+	void BasicNode<T,A>::operator*=(BasicNode& node) {
+		*this = (*this) * node;
+	}
 
-	Node& operator+(double x, Node& parent) {
-		return parent+x;
-	};
-	
-	void Node::operator+=(Node& node) {
-		*this = *this + node;
+	template<typename T, typename A>
+	void BasicNode<T,A>::operator*=(T x) {
+		*this = (*this) * x;
 	}
-	
-	void Node::operator+=(double x) {
-		*this = *this + x;
+
+	template<typename T, typename A>
+	void BasicNode<T,A>::operator/=(BasicNode& node) {
+		*this = (*this) / node;
 	}
 
-	Node& operator-(Node& parent1, Node& parent2) {
-		Operation* op = new Subtract();
-		Node* node = new Node(parent1, parent2, op);
-		node->dynamicallyAllocated = true;
-		return *node;
+	template<typename T, typename A>
+	void BasicNode<T,A>::operator/=(T x) {
+		*this = (*this) / x;
 	}
 
-	Node& operator-(Node& parent, double x) {
-		Operation* op = new Subtract(x, false);
-		Node* node = new Node(parent, op);
+	//create a node on the heap. it's adopted by the named node it's eventually assigned to, and deleted along with it.
+	//if the parents belong to a graph, the node goes into that graph instead. the parents must all be in the same graph,
+	//or all free-standing: a graph doesn't unlink its nodes from anything outside it when it's cleared
+	template<typename T, typename A>
+	BasicNode<T,A>& makeNode(std::vector<BasicNode<T,A>*> parents, BasicOperation<T,A>* operation) {
+		BasicGraph<T,A>* graph = parents.empty() ? nullptr : parents[0]->graph;
+		for(BasicNode<T,A>* parent : parents) {
+			if(parent->graph != graph) {
+				delete operation;
+				throw "Can't combine nodes from different graphs, or graph nodes with free-standing ones";
+			}
+		}
+		if(graph != nullptr) {
+			return *graph->construct(parents, operation);
+		}
+		BasicNode<T,A>* node = new BasicNode<T,A>(parents, operation);
 		node->dynamicallyAllocated = true;
 		return *node;
 	}
-	
-	Node& operator-(double x, Node& parent) {
-		Operation* op = new Subtract(x, true);
-		Node* node = new Node(parent, op);
-		node->dynamicallyAllocated = true;
-		return *node;
+
+	//the constant in mixed expressions like node + 2 has the node's scalar type. it's written as
+	//typename BasicNode<T,A>::Scalar so that it isn't used to deduce T, and e.g. an int converts to it
+	template<typename T, typename A>
+	BasicNode<T,A>& operator+(BasicNode<T,A>& parent1, BasicNode<T,A>& parent2) {
+		return makeNode<T,A>({&parent1, &parent2}, new Add<T,A>());
 	}
-	
-	void Node::operator-=(Node& node) {
-		*this = *this - node;
+
+	template<typename T, typename A>
+	BasicNode<T,A>& operator+(BasicNode<T,A>& parent, typename BasicNode<T,A>::Scalar x) {
+		return makeNode<T,A>({&parent}, new Add<T,A>(x));
+	}
+
+	template<typename T, typename A>
+	BasicNode<T,A>& operator+(typename BasicNode<T,A>::Scalar x, BasicNode<T,A>& parent) {
+		return parent+x;
+	}
+
+	template<typename T, typename A>
+	BasicNode<T,A>& operator-(BasicNode<T,A>& parent1, BasicNode<T,A>& parent2) {
+		return makeNode<T,A>({&parent1, &parent2}, new Subtract<T,A>());
+	}
+
+	template<typename T, typename A>
+	BasicNode<T,A>& operator-(BasicNode<T,A>& parent, typename BasicNode<T,A>::Scalar x) {
+		return makeNode<T,A>({&parent}, new Subtract<T,A>(x, false));
 	}
 	
-	void Node::operator-=(double x) {
-		*this = *this - x;
+	template<typename T, typename A>
+	BasicNode<T,A>& operator-(typename BasicNode<T,A>::Scalar x, BasicNode<T,A>& parent) {
+		return makeNode<T,A>({&parent}, new Subtract<T,A>(x, true));
 	}
 
-	Node& operator*(Node& parent1, Node& parent2) {
-		Operation* op = new Multiply();
-		Node* node = new Node(parent1, parent2, op);
-		node->dynamicallyAllocated = true;
-		return *node;
+	template<typename T, typename A>
+	BasicNode<T,A>& operator*(BasicNode<T,A>& parent1, BasicNode<T,A>& parent2) {
+		return makeNode<T,A>({&parent1, &parent2}, new Multiply<T,A>());
 	}
 
-	Node& operator*(Node& parent, double x) {
-		Operation* op = new Multiply(x);
-		Node* node = new Node(parent, op);
-		node->dynamicallyAllocated = true;
-		return *node;
+	template<typename T, typename A>
+	BasicNode<T,A>& operator*(BasicNode<T,A>& parent, typename BasicNode<T,A>::Scalar x) {
+		return makeNode<T,A>({&parent}, new Multiply<T,A>(x));
 	}
 
-	Node& operator*(double x, Node& parent) {
+	template<typename T, typename A>
+	BasicNode<T,A>& operator*(typename BasicNode<T,A>::Scalar x, BasicNode<T,A>& parent) {
 		return parent * x;
 	}
 	
-	void Node::operator*=(Node& node) {
-		*this = (*this) * node;
+	template<typename T, typename A>
+	BasicNode<T,A>& operator/(BasicNode<T,A>& parent1, BasicNode<T,A>& parent2) {
+		return makeNode<T,A>({&parent1, &parent2}, new Divide<T,A>());
+	}
+
+	template<typename T, typename A>
+	BasicNode<T,A>& operator/(BasicNode<T,A>& parent, typename BasicNode<T,A>::Scalar x) {
+		return makeNode<T,A>({&parent}, new Divide<T,A>(x, false));
+	}
+
+	template<typename T, typename A>
+	BasicNode<T,A>& operator/(typename BasicNode<T,A>::Scalar x, BasicNode<T,A>& parent) {
+		return makeNode<T,A>({&parent}, new Divide<T,A>(x, true));
+	}
+
+	template<typename T, typename A>
+	BasicNode<T,A>& log(BasicNode<T,A>& parent, typename BasicNode<T,A>::Scalar base = -1) {
+		BasicOperation<T,A>* op;
+		if(base == -1) {
+			op = new Log<T,A>();
+		} else {
+			op = new Log<T,A>(base);
+		}
+		return makeNode<T,A>({&parent}, op);
 	}
 	
-	void Node::operator*=(double x) {
-		*this = (*this) * x;
+	template<typename T, typename A>
+	BasicNode<T,A>& exp(BasicNode<T,A>& parent) {
+		return makeNode<T,A>({&parent}, new Exp<T,A>);
 	}
 	
-	Node& operator/(Node& parent1, Node& parent2) {
-		Operation* op = new Divide();
-		Node* node = new Node(parent1, parent2, op);
-		node->dynamicallyAllocated = true;
-		return *node;
+	//a single node adding (or multiplying) any number of parents, rather than a chain of binary nodes.
+	//the initializer_list overloads let ad::sum({&a, &b, &c}) deduce the node type
+	template<typename T, typename A>
+	BasicNode<T,A>& sum(std::vector<BasicNode<T,A>*> parents) {
+		if(parents.size() == 0) {
+			throw "sum requires at least one node";
+		}
+		return makeNode<T,A>(parents, new Add<T,A>());
 	}
-
-	Node& operator/(Node& parent, double x) {
-		Operation* op = new Divide(x, false);
-		Node* node = new Node(parent, op);
-		node->dynamicallyAllocated = true;
-		return *node;
+	
+	template<typename T, typename A>
+	BasicNode<T,A>& sum(std::initializer_list<BasicNode<T,A>*> parents) {
+		return sum(std::vector<BasicNode<T,A>*>(parents));
 	}
-
-	Node& operator/(double x, Node& parent) {
-		Operation* op = new Divide(x, true);
-		Node* node = new Node(parent, op);
-		node->dynamicallyAllocated = true;
-		return *node;
+	
+	template<typename T, typename A>
+	BasicNode<T,A>& product(std::vector<BasicNode<T,A>*> parents) {
+		if(parents.size() == 0) {
+			throw "product requires at least one node";
+		}
+		return makeNode<T,A>(parents, new Multiply<T,A>());
 	}
 	
-	void Node::operator/=(Node& node) {
-		*this = (*this) / node;
+	template<typename T, typename A>
+	BasicNode<T,A>& product(std::initializer_list<BasicNode<T,A>*> parents) {
+		return product(std::vector<BasicNode<T,A>*>(parents));
 	}
 	
-	void Node::operator/=(double x) {
-		*this = (*this) / x;
+	//fused operations: each is a single node in place of the equivalent composition of the operators above
+	template<typename T, typename A>
+	BasicNode<T,A>& logSumExp(std::vector<BasicNode<T,A>*> parents) {
+		return makeNode<T,A>(parents, new LogSumExp<T,A>);
 	}
-
-	Node& log(Node& parent, double base = -1) {
-		Operation* op;
-		if(base == -1) {
-			op = new Log();
-		} else {
-			op = new Log(base);
+	
+	template<typename T, typename A>
+	BasicNode<T,A>& logSumExp(std::initializer_list<BasicNode<T,A>*> parents) {
+		return logSumExp(std::vector<BasicNode<T,A>*>(parents));
+	}
+	
+	//component index of the softmax of parents. this builds its own logSumExp node; for more than one component,
+	//make the logSumExp once and use softmax(x, lse) below
+	template<typename T, typename A>
+	BasicNode<T,A>& softmax(std::vector<BasicNode<T,A>*> parents, int index) {
+		if(index < 0 || index >= (int)parents.size()) {
+			throw "Softmax index is out of range of its arguments";
 		}
-		Node* node = new Node(parent, op);
-		node->dynamicallyAllocated = true;
-		return *node;
+		return makeNode<T,A>({parents[index], &logSumExp(parents)}, new Softmax<T,A>);
 	}
 	
-	Node& exp(Node& parent) {
-		Operation* op = new Exp;
-		Node* node = new Node(parent, op);
-		node->dynamicallyAllocated = true;
-		return *node;
+	//the component of a softmax for input x, given the logSumExp node of all the inputs. e.g.
+	//ad::Node lse = ad::logSumExp(x); then ad::softmax(*x[i], lse) for each i, which is O(k) in all
+	template<typename T, typename A>
+	BasicNode<T,A>& softmax(BasicNode<T,A>& x, BasicNode<T,A>& logSumExp) {
+		return makeNode<T,A>({&x, &logSumExp}, new Softmax<T,A>);
+	}
+	
+	template<typename T, typename A>
+	BasicNode<T,A>& softmax(std::initializer_list<BasicNode<T,A>*> parents, int index) {
+		return softmax(std::vector<BasicNode<T,A>*>(parents), index);
+	}
+	
+	template<typename T, typename A>
+	BasicNode<T,A>& sigmoid(BasicNode<T,A>& parent) {
+		return makeNode<T,A>({&parent}, new Sigmoid<T,A>);
+	}
+	
+	template<typename T, typename A>
+	BasicNode<T,A>& softplus(BasicNode<T,A>& parent) {
+		return makeNode<T,A>({&parent}, new Softplus<T,A>);
+	}
+	
+	template<typename T, typename A>
+	BasicNode<T,A>& pow(BasicNode<T,A>& base, BasicNode<T,A>& exponent) {
+		return makeNode<T,A>({&base, &exponent}, new Pow<T,A>());
+	}
+	
+	template<typename T, typename A>
+	BasicNode<T,A>& pow(BasicNode<T,A>& base, typename BasicNode<T,A>::Scalar exponent) {
+		return makeNode<T,A>({&base}, new Pow<T,A>(exponent, false));
+	}
+	
+	template<typename T, typename A>
+	BasicNode<T,A>& pow(typename BasicNode<T,A>::Scalar base, BasicNode<T,A>& exponent) {
+		return makeNode<T,A>({&exponent}, new Pow<T,A>(base, true));
+	}
+	
+	template<typename T, typename A>
+	BasicNode<T,A>& sqrt(BasicNode<T,A>& parent) {
+		return makeNode<T,A>({&parent}, new Sqrt<T,A>);
+	}
+	
+	template<typename T, typename A>
+	BasicNode<T,A>& tanh(BasicNode<T,A>& parent) {
+		return makeNode<T,A>({&parent}, new Tanh<T,A>);
+	}
+	
+	//a node computed by a user-defined operation (e.g. a BasicCustomOperation or BasicScalarOperation), which it takes ownership of
+	template<typename T, typename A>
+	BasicNode<T,A>& apply(std::vector<BasicNode<T,A>*> parents, BasicOperation<T,A>* operation) {
+		if(!operation->acceptsArgumentCount(parents.size())) {
+			delete operation;
+			throw "Operation passed to apply doesn't take this number of arguments";
+		}
+		return makeNode<T,A>(parents, operation);
 	}
 };
\ No newline at end of file
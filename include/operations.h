@@ -2,48 +2,372 @@
 
 #include <vector>
 #include <cmath>
+#include <algorithm>
+#include <functional>
 
 namespace ad {
-	struct Operation {
-		virtual ~Operation(){};
-		virtual double evaluate(std::vector<double>&) { return 0.0; }
-		virtual std::vector<double> differentiate(std::vector<double>&) {return std::vector<double>(0); }
+	//T is the scalar type of the values flowing through the graph.
+	//A is the type derivatives are accumulated in: normally T, but it can be wider (e.g. float values, double derivatives)
+	template<typename T, typename A = T>
+	struct BasicOperation {
+		virtual ~BasicOperation(){};
+		virtual T evaluate(std::vector<T>&) { return T(0); }
+		virtual std::vector<T> differentiate(std::vector<T>&) {return std::vector<T>(0); }
+		//output is the value evaluate returned for these inputs, so operations can reuse it instead of recomputing it.
+		//it has a name of its own so that overriding just differentiate(x) doesn't hide it
+		virtual std::vector<T> differentiateWithOutput(std::vector<T>& x, T output) { return differentiate(x); }
+		
+		//whether the operation can take n inputs. Function checks this once for every node when it's constructed
+		virtual bool acceptsArgumentCount(int n) { return true; }
+		
+		//batched kernels, used by Function when it isn't in checked mode
+		//x[j] points to n values of the j-th input, one per batch lane; output holds n values
+		//differentiateBatch accumulates adjoint[i] * d(output)/d(x[j]) into xAdjoints[j][i]
+		//overrides don't check anything: the argument count has already been validated, and domain errors
+		//should just produce NaN or infinity, which Function reports afterwards.
+		//the defaults fall back on the scalar evaluate/differentiate, one lane at a time, and so do check
+		virtual void evaluateBatch(std::vector<const T*>& x, T* output, int n) {
+			int nInputs = x.size();
+			std::vector<T> inputValues(nInputs);
+			for(int i=0; i<n; i++) {
+				for(int j=0; j<nInputs; j++) {
+					inputValues[j] = x[j][i];
+				}
+				output[i] = evaluate(inputValues);
+			}
+		}
+		virtual void differentiateBatch(std::vector<const T*>& x, const T* output, const A* adjoint, std::vector<A*>& xAdjoints, int n) {
+			int nInputs = x.size();
+			std::vector<T> inputValues(nInputs);
+			for(int i=0; i<n; i++) {
+				for(int j=0; j<nInputs; j++) {
+					inputValues[j] = x[j][i];
+				}
+				std::vector<T> derivatives = differentiateWithOutput(inputValues, output[i]);
+				for(int j=0; j<nInputs; j++) {
+					xAdjoints[j][i] += derivatives[j] * adjoint[i];
+				}
+			}
+		}
+		//forward mode: outputTangent[i] = sum over j of d(output)/d(x[j]) * tangents[j][i].
+		//since an operation has a single output, the default gets the partials from differentiateBatch with a unit adjoint
+		virtual void jvpBatch(std::vector<const T*>& x, const T* output, std::vector<const A*>& tangents, A* outputTangent, int n) {
+			int nInputs = x.size();
+			std::vector<A> unit(n, A(1));
+			std::vector<A> partials(nInputs*n, A(0));
+			std::vector<A*> partialPointers(nInputs);
+			for(int j=0; j<nInputs; j++) {
+				partialPointers[j] = &partials[j*n];
+			}
+			differentiateBatch(x, output, &unit[0], partialPointers, n);
+			for(int i=0; i<n; i++) {
+				outputTangent[i] = A(0);
+			}
+			for(int j=0; j<nInputs; j++) {
+				const A* tj = tangents[j];
+				for(int i=0; i<n; i++) {
+					outputTangent[i] += partials[j*n + i] * tj[i];
+				}
+			}
+		}
+		//taylor mode: x[j] points to the coefficients x[j][0..order] of the j-th input's truncated Taylor series in t
+		//(coefficient k being the k-th derivative with respect to t over k!), output to the output's.
+		//output[0] already holds the value; fill in output[1..order].
+		//the default only knows the first derivatives (from differentiateBatch), so it throws beyond order 1
+		virtual void taylor(std::vector<const T*>& x, T* output, int order) {
+			if(order > 1) {
+				throw "Operation has no Taylor mode rule beyond first order";
+			}
+			if(order < 1) {
+				return;
+			}
+			int nInputs = x.size();
+			A unit(1);
+			std::vector<A> partials(nInputs, A(0));
+			std::vector<A*> partialPointers(nInputs);
+			for(int j=0; j<nInputs; j++) {
+				partialPointers[j] = &partials[j];
+			}
+			differentiateBatch(x, output, &unit, partialPointers, 1);
+			output[1] = T(0);
+			for(int j=0; j<nInputs; j++) {
+				output[1] += T(partials[j]) * x[j][1];
+			}
+		}
+	};
+	
+	typedef BasicOperation<double> Operation;
+	
+	//a view of length contiguous values, as passed to the kernels of a custom operation
+	template<typename U>
+	struct Span {
+		U* data;
+		int length;
+		
+		Span(U* data_, int length_): data(data_), length(length_) {}
+		U& operator[](int i) const { return data[i]; }
+		int size() const { return length; }
+		U* begin() const { return data; }
+		U* end() const { return data + length; }
+	};
+	
+	//base for user-defined operations that come with their own batched kernels, so they run as fast as the built-in ones.
+	//forward and vjp are required; they work on a batch of lanes, inputs[j][i] being the j-th argument in lane i.
+	//jvp is optional: without it, forward mode gets the partials from vjp.
+	//the scalar virtuals are implemented on top of the kernels, one lane at a time, for checked mode.
+	//kernels shouldn't throw on domain errors, just produce NaN or infinity (see Function::setChecked).
+	//create nodes with it using ad::apply
+	template<typename T, typename A = T>
+	struct BasicCustomOperation: BasicOperation<T,A> {
+		typedef Span<const T> Values;
+		
+		//output[i] = f(inputs[0][i], inputs[1][i], ...)
+		virtual void forward(const std::vector<Values>& inputs, Span<T> output) = 0;
+		//accumulate adjoint[i] * d(output)/d(inputs[j]) into inputAdjoints[j][i]
+		virtual void vjp(const std::vector<Values>& inputs, Values output, Span<const A> adjoint, const std::vector<Span<A>>& inputAdjoints) = 0;
+		//outputTangent[i] = sum over j of d(output)/d(inputs[j]) * tangents[j][i]. return false if not implemented
+		virtual bool jvp(const std::vector<Values>& inputs, Values output, const std::vector<Span<const A>>& tangents, Span<A> outputTangent) { return false; }
+		//number of arguments the operation takes, or -1 for any number
+		virtual int arity() { return -1; }
+		
+		virtual bool acceptsArgumentCount(int n) { return arity() < 0 || n == arity(); }
+		virtual T evaluate(std::vector<T>& x) {
+			if(!acceptsArgumentCount(x.size())) {
+				throw "Input to custom Operation has the wrong number of arguments";
+			}
+			std::vector<Values> inputs;
+			for(T& value : x) {
+				inputs.push_back(Values(&value, 1));
+			}
+			T output;
+			forward(inputs, Span<T>(&output, 1));
+			return output;
+		}
+		virtual std::vector<T> differentiate(std::vector<T>& x) {
+			return differentiateWithOutput(x, evaluate(x));
+		}
+		virtual std::vector<T> differentiateWithOutput(std::vector<T>& x, T output) {
+			int nInputs = x.size();
+			std::vector<Values> inputs;
+			for(T& value : x) {
+				inputs.push_back(Values(&value, 1));
+			}
+			A unit(1);
+			std::vector<A> partials(nInputs, A(0));
+			std::vector<Span<A>> inputAdjoints;
+			for(A& partial : partials) {
+				inputAdjoints.push_back(Span<A>(&partial, 1));
+			}
+			vjp(inputs, Values(&output, 1), Span<const A>(&unit, 1), inputAdjoints);
+			return std::vector<T>(partials.begin(), partials.end());
+		}
+		virtual void evaluateBatch(std::vector<const T*>& x, T* output, int n) {
+			std::vector<Values> inputs;
+			for(const T* xj : x) {
+				inputs.push_back(Values(xj, n));
+			}
+			forward(inputs, Span<T>(output, n));
+		}
+		virtual void differentiateBatch(std::vector<const T*>& x, const T* output, const A* adjoint, std::vector<A*>& xAdjoints, int n) {
+			std::vector<Values> inputs;
+			for(const T* xj : x) {
+				inputs.push_back(Values(xj, n));
+			}
+			std::vector<Span<A>> inputAdjoints;
+			for(A* aj : xAdjoints) {
+				inputAdjoints.push_back(Span<A>(aj, n));
+			}
+			vjp(inputs, Values(output, n), Span<const A>(adjoint, n), inputAdjoints);
+		}
+		virtual void jvpBatch(std::vector<const T*>& x, const T* output, std::vector<const A*>& tangents, A* outputTangent, int n) {
+			std::vector<Values> inputs;
+			for(const T* xj : x) {
+				inputs.push_back(Values(xj, n));
+			}
+			std::vector<Span<const A>> inputTangents;
+			for(const A* tj : tangents) {
+				inputTangents.push_back(Span<const A>(tj, n));
+			}
+			if(!jvp(inputs, Values(output, n), inputTangents, Span<A>(outputTangent, n))) {
+				BasicOperation<T,A>::jvpBatch(x, output, tangents, outputTangent, n);
+			}
+		}
+	};
+	
+	typedef BasicCustomOperation<double> CustomOperation;
+	
+	//adapter for operations that only have scalar code: a value function and one giving the partial derivatives
+	//(given the inputs and the value). these run one lane at a time through the scalar fallbacks of BasicOperation,
+	//which is also what happens to a subclass of Operation that only overrides evaluate and differentiate
+	template<typename T, typename A = T>
+	struct BasicScalarOperation: BasicOperation<T,A> {
+		std::function<T(const std::vector<T>&)> value;
+		std::function<std::vector<T>(const std::vector<T>&, T)> gradient;
+		int nArguments;
+		
+		BasicScalarOperation(std::function<T(const std::vector<T>&)> value_, std::function<std::vector<T>(const std::vector<T>&, T)> gradient_, int nArguments_ = -1): value(value_), gradient(gradient_), nArguments(nArguments_) {}
+		virtual bool acceptsArgumentCount(int n) { return nArguments < 0 || n == nArguments; }
+		virtual T evaluate(std::vector<T>& x) {
+			return value(x);
+		}
+		virtual std::vector<T> differentiate(std::vector<T>& x) {
+			return gradient(x, value(x));
+		}
+		virtual std::vector<T> differentiateWithOutput(std::vector<T>& x, T output) {
+			return gradient(x, output);
+		}
+	};
+	
+	typedef BasicScalarOperation<double> ScalarOperation;
+	
+	//arithmetic on truncated Taylor series, for the operations' taylor rules. each series holds coefficients 0..order.
+	//the recurrences come from differentiating y = f(u) once, e.g. y' = y*u' for exp, and matching coefficients,
+	//so every coefficient costs O(order) and a whole series O(order^2)
+	namespace series {
+		//out = a*b. out mustn't be a or b
+		template<typename T>
+		void product(const T* a, const T* b, T* out, int order) {
+			for(int k=0; k<=order; k++) {
+				out[k] = T(0);
+				for(int j=0; j<=k; j++) {
+					out[k] += a[j]*b[k-j];
+				}
+			}
+		}
+		//y = std::exp(scale*u), given y[0]
+		template<typename T>
+		void exp(const T* u, T* y, int order, T scale = T(1)) {
+			for(int k=1; k<=order; k++) {
+				T sum(T(0));
+				for(int j=1; j<=k; j++) {
+					sum += j*u[j]*y[k-j];
+				}
+				y[k] = scale*sum/k;
+			}
+		}
+		//y = scale*std::log(u), given y[0]
+		template<typename T>
+		void log(const T* u, T* y, int order, T scale = T(1)) {
+			for(int k=1; k<=order; k++) {
+				T sum(T(0));
+				for(int j=1; j<k; j++) {
+					sum += j*y[j]*u[k-j];
+				}
+				y[k] = (scale*u[k] - sum/k)/u[0];
+			}
+		}
+		//y = u^c, given y[0]. from u*y' = c*u'*y, which needs u[0] != 0. if u[0] == 0 and c is a whole number,
+		//u^c is a polynomial and is expanded by multiplying out; otherwise the derivatives really are infinite
+		template<typename T>
+		void power(const T* u, T c, T* y, int order) {
+			if(u[0] == 0 && c >= 0 && c == std::floor(c)) {
+				std::vector<T> result(order+1, T(0)), next(order+1);
+				result[0] = T(1);
+				for(int i=0; i<c && i<=order; i++) {
+					product(&result[0], u, &next[0], order);
+					result.swap(next);
+				}
+				if(c > order) {
+					//u has no constant term, so u^c starts at t^c
+					std::fill(result.begin(), result.end(), T(0));
+				}
+				std::copy(result.begin() + 1, result.end(), y + 1);
+				return;
+			}
+			for(int k=1; k<=order; k++) {
+				T sum(T(0));
+				for(int j=1; j<=k; j++) {
+					sum += (c*j - (k-j))*u[j]*y[k-j];
+				}
+				y[k] = sum/(k*u[0]);
+			}
+		}
 	};
 
-	struct Inherit: Operation {
-		virtual double evaluate(std::vector<double>& x) {
+	template<typename T, typename A = T>
+	struct Inherit: BasicOperation<T,A> {
+		virtual bool acceptsArgumentCount(int n) { return n == 1; }
+		virtual T evaluate(std::vector<T>& x) {
 			if(x.size() != 1) {
 	 			throw "Input to Inherit Operation must have exactly one argument";
 	 		}
 			return x[0];
 		}
-		virtual std::vector<double> differentiate(std::vector<double>& x) {
-			return std::vector<double>{1.0};
+		virtual std::vector<T> differentiate(std::vector<T>& x) {
+			return std::vector<T>{T(1)};
+		}
+		virtual void evaluateBatch(std::vector<const T*>& x, T* output, int n) {
+			const T* x0 = x[0];
+			for(int i=0; i<n; i++) {
+				output[i] = x0[i];
+			}
+		}
+		virtual void differentiateBatch(std::vector<const T*>& x, const T* output, const A* adjoint, std::vector<A*>& xAdjoints, int n) {
+			A* a0 = xAdjoints[0];
+			for(int i=0; i<n; i++) {
+				a0[i] += adjoint[i];
+			}
+		}
+		virtual void taylor(std::vector<const T*>& x, T* output, int order) {
+			std::copy(x[0] + 1, x[0] + order + 1, output + 1);
 		}
 	};
 
-	struct Add: Operation {
-		double constant;
-		virtual double evaluate(std::vector<double>& x) {
-			double sum(constant);
+	template<typename T, typename A = T>
+	struct Add: BasicOperation<T,A> {
+		T constant;
+		virtual T evaluate(std::vector<T>& x) {
+			T sum(constant);
 			int n = x.size();
 			for(int i=0; i<n; i++) {
 				sum += x[i];
 			}
 			return sum;
 		}
-		virtual std::vector<double> differentiate(std::vector<double>& x) {
-			return std::vector<double>(x.size(), 1.0);
+		virtual std::vector<T> differentiate(std::vector<T>& x) {
+			return std::vector<T>(x.size(), T(1));
+		}
+		virtual void evaluateBatch(std::vector<const T*>& x, T* output, int n) {
+			for(int i=0; i<n; i++) {
+				output[i] = constant;
+			}
+			int nInputs = x.size();
+			for(int j=0; j<nInputs; j++) {
+				const T* xj = x[j];
+				for(int i=0; i<n; i++) {
+					output[i] += xj[i];
+				}
+			}
+		}
+		virtual void differentiateBatch(std::vector<const T*>& x, const T* output, const A* adjoint, std::vector<A*>& xAdjoints, int n) {
+			int nInputs = x.size();
+			for(int j=0; j<nInputs; j++) {
+				A* aj = xAdjoints[j];
+				for(int i=0; i<n; i++) {
+					aj[i] += adjoint[i];
+				}
+			}
+		}
+		
+		virtual void taylor(std::vector<const T*>& x, T* output, int order) {
+			for(int k=1; k<=order; k++) {
+				output[k] = T(0);
+				for(const T* xj : x) {
+					output[k] += xj[k];
+				}
+			}
 		}
 		
-		Add(double constant_ = 0.0): constant(constant_){};
+		Add(T constant_ = T(0)): constant(constant_){};
 	};
 
-	struct Subtract: Operation {
-		double constant;
+	template<typename T, typename A = T>
+	struct Subtract: BasicOperation<T,A> {
+		T constant;
 		bool useConstant;
 		bool constantFirst;
-		virtual double evaluate(std::vector<double>& x) {
+		virtual bool acceptsArgumentCount(int n) { return n == (useConstant ? 1 : 2); }
+		virtual T evaluate(std::vector<T>& x) {
 			if(useConstant){
 				if(x.size() != 1) {
 					throw "Input to Subtract Operation must have exactly one argument when using constant";
@@ -58,52 +382,159 @@ namespace ad {
 			}
 			return x[0] - x[1];		
 		}
-		virtual std::vector<double> differentiate(std::vector<double>& x) {
+		virtual std::vector<T> differentiate(std::vector<T>& x) {
 			if(useConstant){ 
 				if(constantFirst){
-					return std::vector<double>{-1.0};
+					return std::vector<T>{-T(1)};
+				}
+				return std::vector<T>{T(1)};
+			}
+			return std::vector<T>{T(1),-T(1)};
+		}
+		virtual void evaluateBatch(std::vector<const T*>& x, T* output, int n) {
+			if(useConstant){
+				const T* x0 = x[0];
+				if(constantFirst) {
+					for(int i=0; i<n; i++) {
+						output[i] = constant - x0[i];
+					}
+				} else {
+					for(int i=0; i<n; i++) {
+						output[i] = x0[i] - constant;
+					}
+				}
+				return;
+			}
+			const T* x0 = x[0];
+			const T* x1 = x[1];
+			for(int i=0; i<n; i++) {
+				output[i] = x0[i] - x1[i];
+			}
+		}
+		virtual void differentiateBatch(std::vector<const T*>& x, const T* output, const A* adjoint, std::vector<A*>& xAdjoints, int n) {
+			A* a0 = xAdjoints[0];
+			if(useConstant && constantFirst) {
+				for(int i=0; i<n; i++) {
+					a0[i] -= adjoint[i];
+				}
+				return;
+			}
+			for(int i=0; i<n; i++) {
+				a0[i] += adjoint[i];
+			}
+			if(!useConstant) {
+				A* a1 = xAdjoints[1];
+				for(int i=0; i<n; i++) {
+					a1[i] -= adjoint[i];
 				}
-				return std::vector<double>{1.0};
 			}
-			return std::vector<double>{1.0,-1.0};
 		}
 	
-		Subtract(): constant(0.0), useConstant(false), constantFirst(false) {}
-		Subtract(double constant_, bool constantFirst_): constant(constant_), useConstant(true), constantFirst(constantFirst_) {}
+		virtual void taylor(std::vector<const T*>& x, T* output, int order) {
+			for(int k=1; k<=order; k++) {
+				if(useConstant) {
+					output[k] = constantFirst ? -x[0][k] : x[0][k];
+				} else {
+					output[k] = x[0][k] - x[1][k];
+				}
+			}
+		}
+	
+		Subtract(): constant(T(0)), useConstant(false), constantFirst(false) {}
+		Subtract(T constant_, bool constantFirst_): constant(constant_), useConstant(true), constantFirst(constantFirst_) {}
 	};
 
-	struct Multiply: Operation {
-		double constant;
-		virtual double evaluate(std::vector<double>& x) {
-			double prod(constant);
+	template<typename T, typename A = T>
+	struct Multiply: BasicOperation<T,A> {
+		T constant;
+		virtual T evaluate(std::vector<T>& x) {
+			T prod(constant);
 			int n = x.size();
 			for(int i=0; i<n; i++) {
 				prod *= x[i];
 			}
 			return prod;
 		}
-		virtual std::vector<double> differentiate(std::vector<double>& x) {
+		//the derivative with respect to x[i] is the product of all the other factors.
+		//built from prefix and suffix products, so it's linear in the number of factors and never divides (zeros are fine)
+		virtual std::vector<T> differentiate(std::vector<T>& x) {
 			int n = x.size();
-			std::vector<double> output(n, constant);
+			std::vector<T> output(n);
+			T prefix(constant);
 			for(int i=0; i<n; i++) {
-				for(int j=0; j<n; j++) {
-					if(j==i) {
-						continue;
-					}
-					output[i] *= x[j];
-				}
+				output[i] = prefix;
+				prefix *= x[i];
+			}
+			T suffix(T(1));
+			for(int i=n-1; i>=0; i--) {
+				output[i] *= suffix;
+				suffix *= x[i];
 			}
 			return output;
 		}
+		virtual void evaluateBatch(std::vector<const T*>& x, T* output, int n) {
+			for(int i=0; i<n; i++) {
+				output[i] = constant;
+			}
+			int nInputs = x.size();
+			for(int j=0; j<nInputs; j++) {
+				const T* xj = x[j];
+				for(int i=0; i<n; i++) {
+					output[i] *= xj[i];
+				}
+			}
+		}
+		virtual void differentiateBatch(std::vector<const T*>& x, const T* output, const A* adjoint, std::vector<A*>& xAdjoints, int n) {
+			int nInputs = x.size();
+			//prefix[j] holds adjoint * constant * x[0]*...*x[j-1], for all lanes
+			std::vector<A> prefix(nInputs*n);
+			std::vector<A> running(n);
+			for(int i=0; i<n; i++) {
+				running[i] = constant * adjoint[i];
+			}
+			for(int j=0; j<nInputs; j++) {
+				const T* xj = x[j];
+				A* prefixj = &prefix[j*n];
+				for(int i=0; i<n; i++) {
+					prefixj[i] = running[i];
+					running[i] *= xj[i];
+				}
+			}
+			for(int i=0; i<n; i++) {
+				running[i] = T(1);
+			}
+			for(int j=nInputs-1; j>=0; j--) {
+				const T* xj = x[j];
+				const A* prefixj = &prefix[j*n];
+				A* aj = xAdjoints[j];
+				for(int i=0; i<n; i++) {
+					aj[i] += prefixj[i] * running[i];
+					running[i] *= xj[i];
+				}
+			}
+		}
 
-		Multiply(double constant_ = 1.0): constant(constant_){};
+		//multiply the factors' series together one at a time
+		virtual void taylor(std::vector<const T*>& x, T* output, int order) {
+			std::vector<T> prod(order+1, T(0)), next(order+1);
+			prod[0] = constant;
+			for(const T* xj : x) {
+				series::product(&prod[0], xj, &next[0], order);
+				prod.swap(next);
+			}
+			std::copy(prod.begin() + 1, prod.end(), output + 1);
+		}
+
+		Multiply(T constant_ = T(1)): constant(constant_){};
 	};
 	
-	struct Divide: Operation {
-		double constant;
+	template<typename T, typename A = T>
+	struct Divide: BasicOperation<T,A> {
+		T constant;
 		bool useConstant;
 		bool constantFirst;
-		virtual double evaluate(std::vector<double>& x) {
+		virtual bool acceptsArgumentCount(int n) { return n == (useConstant ? 1 : 2); }
+		virtual T evaluate(std::vector<T>& x) {
 			if(useConstant){
 				if(x.size() != 1) {
 					throw "Input to Divide Operation must have exactly one argument when using constant";
@@ -124,28 +555,92 @@ namespace ad {
 			}
 			return x[0]/x[1];		
 		}
-		virtual std::vector<double> differentiate(std::vector<double>& x) {
+		virtual std::vector<T> differentiate(std::vector<T>& x) {
 			if(useConstant){ 
 				if(constantFirst){
-					return std::vector<double>{-constant/(x[0]*x[0])};
+					return std::vector<T>{-constant/(x[0]*x[0])};
+				}
+				return std::vector<T>{T(1)/constant};
+			}
+			return std::vector<T>{T(1)/x[1], -x[0]/(x[1]*x[1])};
+		}
+		virtual void evaluateBatch(std::vector<const T*>& x, T* output, int n) {
+			if(useConstant){
+				const T* x0 = x[0];
+				if(constantFirst) {
+					for(int i=0; i<n; i++) {
+						output[i] = constant/x0[i];
+					}
+				} else {
+					for(int i=0; i<n; i++) {
+						output[i] = x0[i]/constant;
+					}
+				}
+				return;
+			}
+			const T* x0 = x[0];
+			const T* x1 = x[1];
+			for(int i=0; i<n; i++) {
+				output[i] = x0[i]/x1[i];
+			}
+		}
+		virtual void differentiateBatch(std::vector<const T*>& x, const T* output, const A* adjoint, std::vector<A*>& xAdjoints, int n) {
+			A* a0 = xAdjoints[0];
+			if(useConstant){
+				const T* x0 = x[0];
+				if(constantFirst){
+					//d(c/x)/dx = -(c/x)/x
+					for(int i=0; i<n; i++) {
+						a0[i] -= adjoint[i] * output[i] / x0[i];
+					}
+				} else {
+					for(int i=0; i<n; i++) {
+						a0[i] += adjoint[i] / constant;
+					}
+				}
+				return;
+			}
+			const T* x1 = x[1];
+			A* a1 = xAdjoints[1];
+			for(int i=0; i<n; i++) {
+				A scaled = adjoint[i] / x1[i];
+				a0[i] += scaled;
+				a1[i] -= scaled * output[i];
+			}
+		}
+	
+		//y = numerator/denominator, from numerator = y*denominator
+		virtual void taylor(std::vector<const T*>& x, T* output, int order) {
+			if(useConstant && !constantFirst) {
+				for(int k=1; k<=order; k++) {
+					output[k] = x[0][k]/constant;
+				}
+				return;
+			}
+			const T* denominator = useConstant ? x[0] : x[1];
+			for(int k=1; k<=order; k++) {
+				T sum = useConstant ? T(0) : x[0][k];
+				for(int j=0; j<k; j++) {
+					sum -= output[j]*denominator[k-j];
 				}
-				return std::vector<double>{1.0/constant};
+				output[k] = sum/denominator[0];
 			}
-			return std::vector<double>{1.0/x[1], -x[0]/(x[1]*x[1])};
 		}
 	
-		Divide(): constant(0.0), useConstant(false), constantFirst(false) {}
-		Divide(double constant_, bool constantFirst_): constant(constant_), useConstant(true), constantFirst(constantFirst_) {
+		Divide(): constant(T(0)), useConstant(false), constantFirst(false) {}
+		Divide(T constant_, bool constantFirst_): constant(constant_), useConstant(true), constantFirst(constantFirst_) {
 			if(!constantFirst && constant == 0) {
 				throw "Tried to create a Divide operation that divides by zero";
 			}
 		}
 	};
 	
-	struct Log: Operation {
-		double base;
+	template<typename T, typename A = T>
+	struct Log: BasicOperation<T,A> {
+		T base;
 		bool doNaturalLog;
-		virtual double evaluate(std::vector<double>& x) {
+		virtual bool acceptsArgumentCount(int n) { return n == 1; }
+		virtual T evaluate(std::vector<T>& x) {
 			if(x.size() != 1) {
 				throw "Input to Log Operation must have exactly one argument";
 			}
@@ -153,12 +648,12 @@ namespace ad {
 				throw "Log operation tried to take log of non-positive number";
 			}
 			if(doNaturalLog) {
-				return log(x[0]);
+				return std::log(x[0]);
 			} else {
-				return log(x[0])/log(base);
+				return std::log(x[0])/std::log(base);
 			}
 		}
-		virtual std::vector<double> differentiate(std::vector<double>& x) {
+		virtual std::vector<T> differentiate(std::vector<T>& x) {
 			if(x.size() != 1) {
 				throw "Input to Log Operation must have exactly one argument";
 			}
@@ -166,32 +661,521 @@ namespace ad {
 				throw "Log Operation tried to divide by zero during differentiation";
 			}
 			if(doNaturalLog) {
-				return std::vector<double>{1.0/x[0]};
+				return std::vector<T>{T(1)/x[0]};
 			} else {
-				return std::vector<double>{1.0/(log(base)*x[0])};
+				return std::vector<T>{T(1)/(std::log(base)*x[0])};
 			}
 		}
+		virtual void evaluateBatch(std::vector<const T*>& x, T* output, int n) {
+			const T* x0 = x[0];
+			T scale = doNaturalLog ? T(1) : T(1)/std::log(base);
+			for(int i=0; i<n; i++) {
+				output[i] = std::log(x0[i]) * scale;
+			}
+		}
+		virtual void differentiateBatch(std::vector<const T*>& x, const T* output, const A* adjoint, std::vector<A*>& xAdjoints, int n) {
+			const T* x0 = x[0];
+			A* a0 = xAdjoints[0];
+			T scale = doNaturalLog ? T(1) : T(1)/std::log(base);
+			for(int i=0; i<n; i++) {
+				a0[i] += adjoint[i] * scale / x0[i];
+			}
+		}
+		
+		virtual void taylor(std::vector<const T*>& x, T* output, int order) {
+			series::log(x[0], output, order, doNaturalLog ? T(1) : T(1)/std::log(base));
+		}
 		
-		Log(): base(0.0), doNaturalLog(true) {}
-		Log(double base_): base(base_), doNaturalLog(false) {
+		Log(): base(T(0)), doNaturalLog(true) {}
+		Log(T base_): base(base_), doNaturalLog(false) {
 			if(base <= 0) {
 				throw "Log operation requires base > 0";
 			}
 		}
 	};
 	
-	struct Exp: Operation {
-		virtual double evaluate(std::vector<double>& x) {
+	template<typename T, typename A = T>
+	struct Exp: BasicOperation<T,A> {
+		virtual bool acceptsArgumentCount(int n) { return n == 1; }
+		virtual T evaluate(std::vector<T>& x) {
+			if(x.size() != 1) {
+				throw "Input to Exponentiate Operation must have exactly one argument";
+			}
+			return std::exp(x[0]);
+		}
+		virtual std::vector<T> differentiate(std::vector<T>& x) {
 			if(x.size() != 1) {
 				throw "Input to Exponentiate Operation must have exactly one argument";
 			}
-			return exp(x[0]);
+			return std::vector<T>{std::exp(x[0])};
 		}
-		virtual std::vector<double> differentiate(std::vector<double>& x) {
+		virtual std::vector<T> differentiateWithOutput(std::vector<T>& x, T output) {
 			if(x.size() != 1) {
 				throw "Input to Exponentiate Operation must have exactly one argument";
 			}
-			return std::vector<double>{exp(x[0])};
+			return std::vector<T>{output};
+		}
+		virtual void evaluateBatch(std::vector<const T*>& x, T* output, int n) {
+			const T* x0 = x[0];
+			for(int i=0; i<n; i++) {
+				output[i] = std::exp(x0[i]);
+			}
+		}
+		virtual void differentiateBatch(std::vector<const T*>& x, const T* output, const A* adjoint, std::vector<A*>& xAdjoints, int n) {
+			//d(std::exp(x))/dx is the forward value itself
+			A* a0 = xAdjoints[0];
+			for(int i=0; i<n; i++) {
+				a0[i] += adjoint[i] * output[i];
+			}
+		}
+		virtual void taylor(std::vector<const T*>& x, T* output, int order) {
+			series::exp(x[0], output, order);
+		}
+	};
+	
+	//fused operations. each replaces a small subgraph of the basic operations above with a single node,
+	//is written to avoid overflow where the naive composition would, and reuses its forward value in the backward pass
+	
+	//std::log(std::exp(x[0]) + std::exp(x[1]) + ...), computed as m + std::log(sum(std::exp(x[j] - m))) with m = max(x)
+	template<typename T, typename A = T>
+	struct LogSumExp: BasicOperation<T,A> {
+		virtual bool acceptsArgumentCount(int n) { return n >= 1; }
+		virtual T evaluate(std::vector<T>& x) {
+			int n = x.size();
+			if(n == 0) {
+				throw "Input to LogSumExp Operation must have at least one argument";
+			}
+			T m = *std::max_element(x.begin(), x.end());
+			T sum(T(0));
+			for(int i=0; i<n; i++) {
+				sum += std::exp(x[i] - m);
+			}
+			return m + std::log(sum);
+		}
+		virtual std::vector<T> differentiate(std::vector<T>& x) {
+			return differentiateWithOutput(x, evaluate(x));
+		}
+		//the derivative with respect to x[i] is softmax(x)[i] = std::exp(x[i] - output)
+		virtual std::vector<T> differentiateWithOutput(std::vector<T>& x, T output) {
+			int n = x.size();
+			std::vector<T> derivatives(n);
+			for(int i=0; i<n; i++) {
+				derivatives[i] = std::exp(x[i] - output);
+			}
+			return derivatives;
+		}
+		virtual void evaluateBatch(std::vector<const T*>& x, T* output, int n) {
+			int nInputs = x.size();
+			std::vector<T> m(x[0], x[0] + n);
+			for(int j=1; j<nInputs; j++) {
+				const T* xj = x[j];
+				for(int i=0; i<n; i++) {
+					m[i] = xj[i] > m[i] ? xj[i] : m[i];
+				}
+			}
+			for(int i=0; i<n; i++) {
+				output[i] = T(0);
+			}
+			for(int j=0; j<nInputs; j++) {
+				const T* xj = x[j];
+				for(int i=0; i<n; i++) {
+					output[i] += std::exp(xj[i] - m[i]);
+				}
+			}
+			for(int i=0; i<n; i++) {
+				output[i] = m[i] + std::log(output[i]);
+			}
+		}
+		virtual void differentiateBatch(std::vector<const T*>& x, const T* output, const A* adjoint, std::vector<A*>& xAdjoints, int n) {
+			int nInputs = x.size();
+			for(int j=0; j<nInputs; j++) {
+				const T* xj = x[j];
+				A* aj = xAdjoints[j];
+				for(int i=0; i<n; i++) {
+					aj[i] += adjoint[i] * std::exp(xj[i] - output[i]);
+				}
+			}
+		}
+		//output[0] + std::log(sum(std::exp(x[j] - output[0]))), where the sum starts at 1
+		virtual void taylor(std::vector<const T*>& x, T* output, int order) {
+			std::vector<T> sum(order+1, T(0)), term(order+1);
+			for(const T* xj : x) {
+				term[0] = std::exp(xj[0] - output[0]);
+				series::exp(xj, &term[0], order);
+				for(int k=0; k<=order; k++) {
+					sum[k] += term[k];
+				}
+			}
+			series::log(&sum[0], output, order);
+		}
+	};
+	
+	//a component of softmax(x): std::exp(x[0] - x[1]), where x[1] is logsumexp of all the components' inputs.
+	//the logsumexp is a node of its own, so all k components can share it and a whole softmax costs O(k)
+	template<typename T, typename A = T>
+	struct Softmax: BasicOperation<T,A> {
+		virtual bool acceptsArgumentCount(int n) { return n == 2; }
+		virtual T evaluate(std::vector<T>& x) {
+			if(x.size() != 2) {
+				throw "Input to Softmax Operation must be one input and the logsumexp of all of them";
+			}
+			return std::exp(x[0] - x[1]);
+		}
+		virtual std::vector<T> differentiate(std::vector<T>& x) {
+			return differentiateWithOutput(x, evaluate(x));
+		}
+		//the rest of d(s[i])/d(x[j]) = s[i] * (delta(i,j) - s[j]) comes through the logsumexp node
+		virtual std::vector<T> differentiateWithOutput(std::vector<T>& x, T output) {
+			return std::vector<T>{output, -output};
+		}
+		virtual void evaluateBatch(std::vector<const T*>& x, T* output, int n) {
+			const T* x0 = x[0];
+			const T* x1 = x[1];
+			for(int i=0; i<n; i++) {
+				output[i] = std::exp(x0[i] - x1[i]);
+			}
+		}
+		virtual void differentiateBatch(std::vector<const T*>& x, const T* output, const A* adjoint, std::vector<A*>& xAdjoints, int n) {
+			A* a0 = xAdjoints[0];
+			A* a1 = xAdjoints[1];
+			for(int i=0; i<n; i++) {
+				A scaled = adjoint[i] * output[i];
+				a0[i] += scaled;
+				a1[i] -= scaled;
+			}
+		}
+		virtual void taylor(std::vector<const T*>& x, T* output, int order) {
+			std::vector<T> exponent(order+1);
+			for(int k=0; k<=order; k++) {
+				exponent[k] = x[0][k] - x[1][k];
+			}
+			series::exp(&exponent[0], output, order);
+		}
+	};
+	
+	//1/(1 + std::exp(-x)), evaluated without overflow for large |x|
+	template<typename T, typename A = T>
+	struct Sigmoid: BasicOperation<T,A> {
+		virtual bool acceptsArgumentCount(int n) { return n == 1; }
+		static T sigmoid(T x) {
+			if(x >= 0) {
+				return T(1)/(T(1) + std::exp(-x));
+			}
+			T e = std::exp(x);
+			return e/(T(1) + e);
+		}
+		virtual T evaluate(std::vector<T>& x) {
+			if(x.size() != 1) {
+				throw "Input to Sigmoid Operation must have exactly one argument";
+			}
+			return sigmoid(x[0]);
+		}
+		virtual std::vector<T> differentiate(std::vector<T>& x) {
+			return differentiateWithOutput(x, evaluate(x));
+		}
+		virtual std::vector<T> differentiateWithOutput(std::vector<T>& x, T output) {
+			return std::vector<T>{output*(T(1) - output)};
+		}
+		virtual void evaluateBatch(std::vector<const T*>& x, T* output, int n) {
+			//std::exp(-|x|) never overflows; pick the form per sign without branching on the expensive part
+			const T* x0 = x[0];
+			for(int i=0; i<n; i++) {
+				T e = std::exp(-std::fabs(x0[i]));
+				T positive = T(1)/(T(1) + e);
+				output[i] = x0[i] >= 0 ? positive : e*positive;
+			}
+		}
+		virtual void differentiateBatch(std::vector<const T*>& x, const T* output, const A* adjoint, std::vector<A*>& xAdjoints, int n) {
+			A* a0 = xAdjoints[0];
+			for(int i=0; i<n; i++) {
+				a0[i] += adjoint[i] * output[i] * (T(1) - output[i]);
+			}
+		}
+		//y' = w*u' with w = y*(1 - y), whose coefficient k-1 only needs y up to k-1
+		virtual void taylor(std::vector<const T*>& x, T* output, int order) {
+			const T* u = x[0];
+			std::vector<T> w(order+1);
+			for(int k=1; k<=order; k++) {
+				w[k-1] = output[k-1];
+				for(int j=0; j<k; j++) {
+					w[k-1] -= output[j]*output[k-1-j];
+				}
+				T sum(T(0));
+				for(int j=1; j<=k; j++) {
+					sum += j*u[j]*w[k-j];
+				}
+				output[k] = sum/k;
+			}
+		}
+	};
+	
+	//std::log(1 + std::exp(x)), computed as max(x,0) + std::log1p(std::exp(-|x|))
+	template<typename T, typename A = T>
+	struct Softplus: BasicOperation<T,A> {
+		virtual bool acceptsArgumentCount(int n) { return n == 1; }
+		virtual T evaluate(std::vector<T>& x) {
+			if(x.size() != 1) {
+				throw "Input to Softplus Operation must have exactly one argument";
+			}
+			return (x[0] > 0 ? x[0] : T(0)) + std::log1p(std::exp(-std::fabs(x[0])));
+		}
+		//the derivative is sigmoid(x) = 1 - std::exp(-output)
+		virtual std::vector<T> differentiate(std::vector<T>& x) {
+			return differentiateWithOutput(x, evaluate(x));
+		}
+		virtual std::vector<T> differentiateWithOutput(std::vector<T>& x, T output) {
+			return std::vector<T>{-std::expm1(-output)};
+		}
+		virtual void evaluateBatch(std::vector<const T*>& x, T* output, int n) {
+			const T* x0 = x[0];
+			for(int i=0; i<n; i++) {
+				output[i] = (x0[i] > 0 ? x0[i] : T(0)) + std::log1p(std::exp(-std::fabs(x0[i])));
+			}
+		}
+		virtual void differentiateBatch(std::vector<const T*>& x, const T* output, const A* adjoint, std::vector<A*>& xAdjoints, int n) {
+			A* a0 = xAdjoints[0];
+			for(int i=0; i<n; i++) {
+				a0[i] -= adjoint[i] * std::expm1(-output[i]);
+			}
+		}
+		//y' = sigmoid(u)*u'
+		virtual void taylor(std::vector<const T*>& x, T* output, int order) {
+			const T* u = x[0];
+			std::vector<T> s(order+1);
+			s[0] = -std::expm1(-output[0]);
+			Sigmoid<T,A>().taylor(x, &s[0], order-1);
+			for(int k=1; k<=order; k++) {
+				T sum(T(0));
+				for(int j=1; j<=k; j++) {
+					sum += j*u[j]*s[k-j];
+				}
+				output[k] = sum/k;
+			}
+		}
+	};
+	
+	//x[0]^x[1], or x^constant, or constant^x
+	template<typename T, typename A = T>
+	struct Pow: BasicOperation<T,A> {
+		T constant;
+		bool useConstant;
+		bool constantFirst;
+		virtual bool acceptsArgumentCount(int n) { return n == (useConstant ? 1 : 2); }
+		static void checkDomain(T base, T exponent) {
+			if(base < 0 && exponent != std::floor(exponent)) {
+				throw "Pow operation tried to raise a negative number to a non-integer power";
+			}
+		}
+		//d(base^exponent)/d(exponent) = output*std::log(base)
+		static T exponentDerivative(T base, T output) {
+			if(base > 0) {
+				return output*std::log(base);
+			}
+			if(base == 0) {
+				return T(0);
+			}
+			throw "Pow operation can't differentiate with respect to the exponent of a negative number";
+		}
+		virtual T evaluate(std::vector<T>& x) {
+			if(useConstant){
+				if(x.size() != 1) {
+					throw "Input to Pow Operation must have exactly one argument when using constant";
+				}
+				if(constantFirst) {
+					checkDomain(constant, x[0]);
+					return std::pow(constant, x[0]);
+				}
+				checkDomain(x[0], constant);
+				return std::pow(x[0], constant);
+			}
+			if(x.size() != 2) {
+				throw "Input to Pow Operation must have exactly two arguments";
+			}
+			checkDomain(x[0], x[1]);
+			return std::pow(x[0], x[1]);
+		}
+		virtual std::vector<T> differentiate(std::vector<T>& x) {
+			return differentiateWithOutput(x, evaluate(x));
+		}
+		virtual std::vector<T> differentiateWithOutput(std::vector<T>& x, T output) {
+			if(useConstant){ 
+				if(constantFirst){
+					return std::vector<T>{exponentDerivative(constant, output)};
+				}
+				return std::vector<T>{constant*std::pow(x[0], constant - T(1))};
+			}
+			return std::vector<T>{x[1]*std::pow(x[0], x[1] - T(1)), exponentDerivative(x[0], output)};
+		}
+		virtual void evaluateBatch(std::vector<const T*>& x, T* output, int n) {
+			if(useConstant){
+				const T* x0 = x[0];
+				if(constantFirst) {
+					for(int i=0; i<n; i++) {
+						output[i] = std::pow(constant, x0[i]);
+					}
+				} else if(constant == T(2)) {
+					for(int i=0; i<n; i++) {
+						output[i] = x0[i]*x0[i];
+					}
+				} else {
+					for(int i=0; i<n; i++) {
+						output[i] = std::pow(x0[i], constant);
+					}
+				}
+				return;
+			}
+			const T* x0 = x[0];
+			const T* x1 = x[1];
+			for(int i=0; i<n; i++) {
+				output[i] = std::pow(x0[i], x1[i]);
+			}
+		}
+		virtual void differentiateBatch(std::vector<const T*>& x, const T* output, const A* adjoint, std::vector<A*>& xAdjoints, int n) {
+			const T* x0 = x[0];
+			A* a0 = xAdjoints[0];
+			if(useConstant){
+				if(constantFirst) {
+					T logConstant = constant == 0 ? T(0) : std::log(constant);
+					for(int i=0; i<n; i++) {
+						a0[i] += adjoint[i] * output[i] * logConstant;
+					}
+				} else if(constant == T(2)) {
+					for(int i=0; i<n; i++) {
+						a0[i] += adjoint[i] * T(2) * x0[i];
+					}
+				} else {
+					for(int i=0; i<n; i++) {
+						a0[i] += adjoint[i] * constant * std::pow(x0[i], constant - T(1));
+					}
+				}
+				return;
+			}
+			const T* x1 = x[1];
+			A* a1 = xAdjoints[1];
+			for(int i=0; i<n; i++) {
+				a0[i] += adjoint[i] * x1[i] * std::pow(x0[i], x1[i] - T(1));
+				//log of a negative base is NaN, which is the right answer here
+				a1[i] += adjoint[i] * (x0[i] == 0 ? T(0) : output[i]*std::log(x0[i]));
+			}
+		}
+		
+		//constant^x is std::exp(x*std::log(constant)). with a variable exponent that's really varying, x[0]^x[1] is
+		//std::exp(x[1]*std::log(x[0])), which needs x[0] > 0; otherwise it's x[0] to a fixed power
+		virtual void taylor(std::vector<const T*>& x, T* output, int order) {
+			if(useConstant) {
+				if(constantFirst) {
+					series::exp(x[0], output, order, constant == 0 ? T(0) : std::log(constant));
+				} else {
+					series::power(x[0], constant, output, order);
+				}
+				return;
+			}
+			bool exponentVaries(false);
+			for(int k=1; k<=order; k++) {
+				exponentVaries = exponentVaries || x[1][k] != 0;
+			}
+			if(!exponentVaries) {
+				series::power(x[0], x[1][0], output, order);
+				return;
+			}
+			std::vector<T> logBase(order+1), exponent(order+1);
+			logBase[0] = std::log(x[0][0]);
+			series::log(x[0], &logBase[0], order);
+			series::product(x[1], &logBase[0], &exponent[0], order);
+			series::exp(&exponent[0], output, order);
+		}
+		
+		Pow(): constant(T(0)), useConstant(false), constantFirst(false) {}
+		Pow(T constant_, bool constantFirst_): constant(constant_), useConstant(true), constantFirst(constantFirst_) {}
+	};
+	
+	template<typename T, typename A = T>
+	struct Sqrt: BasicOperation<T,A> {
+		virtual bool acceptsArgumentCount(int n) { return n == 1; }
+		virtual T evaluate(std::vector<T>& x) {
+			if(x.size() != 1) {
+				throw "Input to Sqrt Operation must have exactly one argument";
+			}
+			if(x[0] < 0) {
+				throw "Sqrt operation tried to take square root of negative number";
+			}
+			return std::sqrt(x[0]);
+		}
+		virtual std::vector<T> differentiate(std::vector<T>& x) {
+			return differentiateWithOutput(x, evaluate(x));
+		}
+		virtual std::vector<T> differentiateWithOutput(std::vector<T>& x, T output) {
+			if(output == 0) {
+				throw "Sqrt Operation tried to divide by zero during differentiation";
+			}
+			return std::vector<T>{T(0.5)/output};
+		}
+		virtual void evaluateBatch(std::vector<const T*>& x, T* output, int n) {
+			const T* x0 = x[0];
+			for(int i=0; i<n; i++) {
+				output[i] = std::sqrt(x0[i]);
+			}
+		}
+		virtual void differentiateBatch(std::vector<const T*>& x, const T* output, const A* adjoint, std::vector<A*>& xAdjoints, int n) {
+			A* a0 = xAdjoints[0];
+			for(int i=0; i<n; i++) {
+				a0[i] += adjoint[i] * T(0.5) / output[i];
+			}
+		}
+		//from y*y = u
+		virtual void taylor(std::vector<const T*>& x, T* output, int order) {
+			for(int k=1; k<=order; k++) {
+				T sum = x[0][k];
+				for(int j=1; j<k; j++) {
+					sum -= output[j]*output[k-j];
+				}
+				output[k] = sum/(2*output[0]);
+			}
+		}
+	};
+	
+	template<typename T, typename A = T>
+	struct Tanh: BasicOperation<T,A> {
+		virtual bool acceptsArgumentCount(int n) { return n == 1; }
+		virtual T evaluate(std::vector<T>& x) {
+			if(x.size() != 1) {
+				throw "Input to Tanh Operation must have exactly one argument";
+			}
+			return std::tanh(x[0]);
+		}
+		virtual std::vector<T> differentiate(std::vector<T>& x) {
+			return differentiateWithOutput(x, evaluate(x));
+		}
+		virtual std::vector<T> differentiateWithOutput(std::vector<T>& x, T output) {
+			return std::vector<T>{T(1) - output*output};
+		}
+		virtual void evaluateBatch(std::vector<const T*>& x, T* output, int n) {
+			const T* x0 = x[0];
+			for(int i=0; i<n; i++) {
+				output[i] = std::tanh(x0[i]);
+			}
+		}
+		virtual void differentiateBatch(std::vector<const T*>& x, const T* output, const A* adjoint, std::vector<A*>& xAdjoints, int n) {
+			A* a0 = xAdjoints[0];
+			for(int i=0; i<n; i++) {
+				a0[i] += adjoint[i] * (T(1) - output[i]*output[i]);
+			}
+		}
+		//y' = w*u' with w = 1 - y*y, as for Sigmoid
+		virtual void taylor(std::vector<const T*>& x, T* output, int order) {
+			const T* u = x[0];
+			std::vector<T> w(order+1);
+			for(int k=1; k<=order; k++) {
+				w[k-1] = k == 1 ? T(1) : T(0);
+				for(int j=0; j<k; j++) {
+					w[k-1] -= output[j]*output[k-1-j];
+				}
+				T sum(T(0));
+				for(int j=1; j<=k; j++) {
+					sum += j*u[j]*w[k-j];
+				}
+				output[k] = sum/k;
+			}
 		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,436 @@
+#pragma once
+
+//opt-in instrumentation of Function calls. define AD_PROFILE before including autoDiff.h to turn it on;
+//without it everything below is an empty inline stub, and the calls into it compile away.
+//with it, each operation call is timed, and counts are kept per operation type and per Function.
+//ad::profiling::profiler() then prints a summary table or writes a Chrome trace (load it in chrome://tracing or Perfetto).
+//allocations are only counted if exactly one source file expands AD_PROFILE_COUNT_ALLOCATIONS at namespace scope,
+//which replaces the global operator new and delete with counting versions
+
+#ifdef AD_PROFILE
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <iomanip>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+namespace ad {
+	namespace profiling {
+		typedef std::chrono::steady_clock Clock;
+		typedef Clock::time_point Tick;
+
+		//allocations made on this thread so far, kept by the hooks from AD_PROFILE_COUNT_ALLOCATIONS
+		inline long long& allocationCount() {
+			static thread_local long long count = 0;
+			return count;
+		}
+		inline bool& allocationsCounted() {
+			static bool counted = false;
+			return counted;
+		}
+
+		struct OperationStats {
+			long long forwardCalls, backwardCalls;
+			long long forwardPoints, backwardPoints; //a batched call over n points counts n
+			double forwardSeconds, backwardSeconds;
+			long long allocations;
+
+			OperationStats(): forwardCalls(0), backwardCalls(0), forwardPoints(0), backwardPoints(0), forwardSeconds(0), backwardSeconds(0), allocations(0) {}
+		};
+
+		struct FunctionStats {
+			int nodes, edges;
+			long long calls; //calls to evaluate, differentiate and their batched versions
+			double seconds;
+			long long allocations;
+
+			FunctionStats(): nodes(0), edges(0), calls(0), seconds(0), allocations(0) {}
+		};
+
+		struct TraceEvent {
+			std::string name;
+			std::string category; //"function" or "operation"
+			double start, duration; //microseconds since the profiler started
+			int thread;
+			long long allocations;
+		};
+
+		class Call;
+
+		//collects what every Call records. thread safe: calls merge in under a lock once they finish
+		class Profiler {
+			private:
+				mutable std::mutex mutex;
+				Tick epoch;
+				bool traceOperations;
+				std::unordered_map<std::string, OperationStats> operations;
+				std::vector<std::string> functionNames; //in the order they were first seen
+				std::unordered_map<std::string, FunctionStats> functions;
+				std::vector<TraceEvent> events;
+				std::unordered_map<std::type_index, std::string> operationNames;
+				std::unordered_map<std::thread::id, int> threads;
+
+				const std::string& operationName(std::type_index type);
+				void merge(const std::string& functionName, const FunctionStats& function, const std::unordered_map<std::type_index, OperationStats>& callOperations, std::vector<TraceEvent>& callEvents, std::vector<std::type_index>& eventTypes);
+
+				static void writeJsonString(std::ostream& out, const std::string& text);
+
+				friend class Call;
+
+			public:
+				Profiler(): epoch(Clock::now()), traceOperations(false) {}
+
+				//also put an event for every operation call in the trace, rather than just one per Function call.
+				//that's a lot of events for a big graph
+				void setTraceOperations(bool traceOperations_) {
+					std::lock_guard<std::mutex> lock(mutex);
+					traceOperations = traceOperations_;
+				}
+				bool isTracingOperations() const {
+					std::lock_guard<std::mutex> lock(mutex);
+					return traceOperations;
+				}
+				void reset();
+
+				OperationStats operationStats(const std::string& name) const;
+				FunctionStats functionStats(const std::string& name) const;
+
+				void writeSummary(std::ostream& out) const;
+				void writeChromeTrace(std::ostream& out) const;
+		};
+
+		inline Profiler& profiler() {
+			static Profiler instance;
+			return instance;
+		}
+
+		inline std::string nextFunctionName() {
+			static std::mutex mutex;
+			static int count = 0;
+			std::lock_guard<std::mutex> lock(mutex);
+			std::ostringstream name;
+			name << "function " << count++;
+			return name.str();
+		}
+
+		//one call to a Function, recorded on the stack and merged into the profiler when it goes out of scope.
+		//a call made while another is running on the same thread (evaluate inside differentiate) is folded into the outer one
+		class Call {
+			private:
+				Call* outer;
+				std::string functionName;
+				const char* what;
+				FunctionStats function;
+				Tick start;
+				long long startAllocations;
+				bool traceOperations;
+				std::unordered_map<std::type_index, OperationStats> callOperations;
+				std::vector<TraceEvent> callEvents;
+				std::vector<std::type_index> eventTypes; //the operation behind each operation event, named at merge
+
+				static Call*& active() {
+					static thread_local Call* call = nullptr;
+					return call;
+				}
+
+			public:
+				Call(const std::string& functionName_, const char* what_, int nodes, int edges): outer(active()), functionName(functionName_), what(what_) {
+					if(outer != nullptr) {
+						return;
+					}
+					active() = this;
+					function.nodes = nodes;
+					function.edges = edges;
+					function.calls = 1;
+					traceOperations = profiler().isTracingOperations();
+					startAllocations = allocationCount();
+					start = Clock::now();
+				}
+				~Call();
+				Call(const Call&) = delete;
+				Call& operator=(const Call&) = delete;
+
+				Tick tick() const {
+					return Clock::now();
+				}
+				//an operation call that began at start has just finished
+				template<typename O>
+				void record(const O* operation, bool backward, int nPoints, Tick start, long long startAllocations);
+		};
+
+		template<typename O>
+		void Call::record(const O* operation, bool backward, int nPoints, Tick operationStart, long long operationStartAllocations) {
+			Tick end = Clock::now();
+			if(operation == nullptr) {
+				return; //an input node
+			}
+			if(outer != nullptr) {
+				outer->record(operation, backward, nPoints, operationStart, operationStartAllocations);
+				return;
+			}
+			std::type_index type(typeid(*operation));
+			OperationStats& stats = callOperations[type];
+			double seconds = std::chrono::duration<double>(end - operationStart).count();
+			if(backward) {
+				stats.backwardCalls++;
+				stats.backwardPoints += nPoints;
+				stats.backwardSeconds += seconds;
+			} else {
+				stats.forwardCalls++;
+				stats.forwardPoints += nPoints;
+				stats.forwardSeconds += seconds;
+			}
+			long long allocations = allocationCount() - operationStartAllocations;
+			stats.allocations += allocations;
+			if(traceOperations) {
+				TraceEvent event;
+				event.name = backward ? "backward" : "forward";
+				event.category = "operation";
+				event.start = std::chrono::duration<double, std::micro>(operationStart - profiler().epoch).count();
+				event.duration = seconds*1e6;
+				event.allocations = allocations;
+				callEvents.push_back(event);
+				eventTypes.push_back(type);
+			}
+		}
+
+		inline Call::~Call() {
+			if(outer != nullptr) {
+				return;
+			}
+			active() = nullptr;
+			Tick end = Clock::now();
+			function.seconds = std::chrono::duration<double>(end - start).count();
+			function.allocations = allocationCount() - startAllocations;
+
+			TraceEvent event;
+			event.name = functionName + " " + what;
+			event.category = "function";
+			event.start = std::chrono::duration<double, std::micro>(start - profiler().epoch).count();
+			event.duration = function.seconds*1e6;
+			event.allocations = function.allocations;
+			callEvents.push_back(event);
+			profiler().merge(functionName, function, callOperations, callEvents, eventTypes);
+		}
+
+		//"ad::Add<double, double>" becomes "Add"
+		inline const std::string& Profiler::operationName(std::type_index type) {
+			std::unordered_map<std::type_index, std::string>::iterator found = operationNames.find(type);
+			if(found != operationNames.end()) {
+				return found->second;
+			}
+			int status;
+			char* demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+			std::string name = (status == 0) ? demangled : type.name();
+			std::free(demangled);
+			size_t templateStart = name.find('<');
+			if(templateStart != std::string::npos) {
+				name = name.substr(0, templateStart);
+			}
+			size_t namespaceEnd = name.rfind("::");
+			if(namespaceEnd != std::string::npos) {
+				name = name.substr(namespaceEnd + 2);
+			}
+			return operationNames[type] = name;
+		}
+
+		inline void Profiler::merge(const std::string& functionName, const FunctionStats& function, const std::unordered_map<std::type_index, OperationStats>& callOperations, std::vector<TraceEvent>& callEvents, std::vector<std::type_index>& eventTypes) {
+			std::lock_guard<std::mutex> lock(mutex);
+			for(const std::pair<const std::type_index, OperationStats>& entry : callOperations) {
+				OperationStats& stats = operations[operationName(entry.first)];
+				stats.forwardCalls += entry.second.forwardCalls;
+				stats.backwardCalls += entry.second.backwardCalls;
+				stats.forwardPoints += entry.second.forwardPoints;
+				stats.backwardPoints += entry.second.backwardPoints;
+				stats.forwardSeconds += entry.second.forwardSeconds;
+				stats.backwardSeconds += entry.second.backwardSeconds;
+				stats.allocations += entry.second.allocations;
+			}
+
+			if(functions.count(functionName) == 0) {
+				functionNames.push_back(functionName);
+			}
+			FunctionStats& stats = functions[functionName];
+			stats.nodes = function.nodes;
+			stats.edges = function.edges;
+			stats.calls += function.calls;
+			stats.seconds += function.seconds;
+			stats.allocations += function.allocations;
+
+			std::thread::id threadId = std::this_thread::get_id();
+			if(threads.count(threadId) == 0) {
+				int nThreads = threads.size();
+				threads[threadId] = nThreads;
+			}
+			int thread = threads[threadId];
+			int nOperationEvents = eventTypes.size();
+			for(int i=0; i<(int)callEvents.size(); i++) {
+				TraceEvent& event = callEvents[i];
+				if(i < nOperationEvents) {
+					event.name = operationName(eventTypes[i]) + " " + event.name;
+				}
+				event.thread = thread;
+				events.push_back(event);
+			}
+		}
+
+		inline void Profiler::reset() {
+			std::lock_guard<std::mutex> lock(mutex);
+			operations.clear();
+			functionNames.clear();
+			functions.clear();
+			events.clear();
+		}
+
+		//stats for the operation type with the given name (like "Add"), all zero if it hasn't run
+		inline OperationStats Profiler::operationStats(const std::string& name) const {
+			std::lock_guard<std::mutex> lock(mutex);
+			std::unordered_map<std::string, OperationStats>::const_iterator found = operations.find(name);
+			return found == operations.end() ? OperationStats() : found->second;
+		}
+
+		inline FunctionStats Profiler::functionStats(const std::string& name) const {
+			std::lock_guard<std::mutex> lock(mutex);
+			std::unordered_map<std::string, FunctionStats>::const_iterator found = functions.find(name);
+			return found == functions.end() ? FunctionStats() : found->second;
+		}
+
+		//one table of Functions and one of operation types, the latter sorted by total time
+		inline void Profiler::writeSummary(std::ostream& out) const {
+			std::lock_guard<std::mutex> lock(mutex);
+			bool counted = allocationsCounted();
+			std::ios::fmtflags flags = out.flags();
+			out << std::fixed << std::setprecision(3);
+
+			out << std::left << std::setw(24) << "function" << std::right << std::setw(10) << "nodes" << std::setw(10) << "edges"
+				<< std::setw(12) << "calls" << std::setw(14) << "total ms" << std::setw(14) << "us/call" << std::setw(14) << "allocations" << "\n";
+			for(const std::string& name : functionNames) {
+				const FunctionStats& stats = functions.at(name);
+				out << std::left << std::setw(24) << name << std::right << std::setw(10) << stats.nodes << std::setw(10) << stats.edges
+					<< std::setw(12) << stats.calls << std::setw(14) << stats.seconds*1e3 << std::setw(14) << stats.seconds*1e6/stats.calls;
+				if(counted) {
+					out << std::setw(14) << stats.allocations << "\n";
+				} else {
+					out << std::setw(14) << "-" << "\n";
+				}
+			}
+			out << "\n";
+
+			std::vector<std::pair<std::string, OperationStats>> sorted(operations.begin(), operations.end());
+			std::sort(sorted.begin(), sorted.end(), [](const std::pair<std::string, OperationStats>& a, const std::pair<std::string, OperationStats>& b) {
+				return a.second.forwardSeconds + a.second.backwardSeconds > b.second.forwardSeconds + b.second.backwardSeconds;
+			});
+			out << std::left << std::setw(24) << "operation" << std::right << std::setw(12) << "fwd calls" << std::setw(14) << "fwd points" << std::setw(12) << "fwd ms"
+				<< std::setw(12) << "bwd calls" << std::setw(14) << "bwd points" << std::setw(12) << "bwd ms" << std::setw(14) << "allocations" << "\n";
+			for(const std::pair<std::string, OperationStats>& entry : sorted) {
+				const OperationStats& stats = entry.second;
+				out << std::left << std::setw(24) << entry.first << std::right << std::setw(12) << stats.forwardCalls << std::setw(14) << stats.forwardPoints << std::setw(12) << stats.forwardSeconds*1e3
+					<< std::setw(12) << stats.backwardCalls << std::setw(14) << stats.backwardPoints << std::setw(12) << stats.backwardSeconds*1e3;
+				if(counted) {
+					out << std::setw(14) << stats.allocations << "\n";
+				} else {
+					out << std::setw(14) << "-" << "\n";
+				}
+			}
+			out.flags(flags);
+		}
+
+		inline void Profiler::writeJsonString(std::ostream& out, const std::string& text) {
+			out << '"';
+			for(char c : text) {
+				if(c == '"' || c == '\\') {
+					out << '\\' << c;
+				} else if((unsigned char)c < 0x20) {
+					out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec << std::setfill(' ');
+				} else {
+					out << c;
+				}
+			}
+			out << '"';
+		}
+
+		//the trace event format's complete ("X") events, one per Function call and, if traced, per operation call
+		inline void Profiler::writeChromeTrace(std::ostream& out) const {
+			std::lock_guard<std::mutex> lock(mutex);
+			std::ios::fmtflags flags = out.flags();
+			out << std::fixed << std::setprecision(3);
+			out << "{\"traceEvents\":[\n";
+			for(int i=0; i<(int)events.size(); i++) {
+				const TraceEvent& event = events[i];
+				out << "{\"name\":";
+				writeJsonString(out, event.name);
+				out << ",\"cat\":\"" << event.category << "\",\"ph\":\"X\",\"ts\":" << event.start << ",\"dur\":" << event.duration
+					<< ",\"pid\":1,\"tid\":" << event.thread;
+				if(allocationsCounted()) {
+					out << ",\"args\":{\"allocations\":" << event.allocations << "}";
+				}
+				out << "}" << (i+1 < (int)events.size() ? ",\n" : "\n");
+			}
+			out << "],\"displayTimeUnit\":\"ns\"}\n";
+			out.flags(flags);
+		}
+	};
+};
+
+//kept out of line so the compiler doesn't see malloc and free paired with new and delete at the call sites
+#define AD_PROFILE_COUNT_ALLOCATIONS \
+	__attribute__((noinline)) void* operator new(std::size_t size) { \
+		ad::profiling::allocationCount()++; \
+		ad::profiling::allocationsCounted() = true; \
+		void* pointer = std::malloc(size == 0 ? 1 : size); \
+		if(pointer == nullptr) { \
+			throw std::bad_alloc(); \
+		} \
+		return pointer; \
+	} \
+	__attribute__((noinline)) void* operator new[](std::size_t size) { \
+		return operator new(size); \
+	} \
+	__attribute__((noinline)) void operator delete(void* pointer) noexcept { \
+		std::free(pointer); \
+	} \
+	__attribute__((noinline)) void operator delete[](void* pointer) noexcept { \
+		std::free(pointer); \
+	}
+
+#else
+
+#include <string>
+
+//stubs with the same interface, which do nothing
+namespace ad {
+	namespace profiling {
+		struct Tick {};
+
+		inline long long allocationCount() {
+			return 0;
+		}
+		inline std::string nextFunctionName() {
+			return std::string();
+		}
+
+		class Call {
+			public:
+				Call(const std::string&, const char*, int, int) {}
+				Tick tick() const {
+					return Tick();
+				}
+				template<typename O>
+				void record(const O*, bool, int, Tick, long long) {}
+		};
+	};
+};
+
+#define AD_PROFILE_COUNT_ALLOCATIONS
+
+#endif
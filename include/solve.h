@@ -0,0 +1,200 @@
+#pragma once
+
+#include <limits>
+
+namespace ad {
+	//the root y of a residual F(y, p1, ..., pm) = 0, as a single node whose parents are the parameters p.
+	//residual is a Function whose first input is y and whose other inputs are the parameters, in order.
+	//the forward pass iterates natively (Newton's method on F, or with fixedPoint, y <- F(y, p) until y stops moving),
+	//and the gradient comes from the implicit function theorem instead of differentiating through the iterations:
+	//dy/dp = -(dF/dp)/(dF/dy) for a root, or (dF/dp)/(1 - dF/dy) for a fixed point. so the node costs the same
+	//however many iterations it takes. the residual is a scalar Function, so the adjoint solve is a division.
+	//the residual is only called through its batched methods, which leave its nodes alone, and it must outlive the node.
+	//all of the residual's inputs must require gradients (the default); the solve throws if they don't.
+	//a solve that doesn't converge throws in checked mode, and gives NaN otherwise.
+	//a negative tolerance means the default, a few hundred ulps relative to y
+	template<typename T, typename A = T>
+	struct Solve: BasicOperation<T,A> {
+		const BasicFunction<T,A>& residual;
+		bool fixedPoint;
+		T initialGuess;
+		T tolerance;
+		int maxIterations;
+
+		Solve(const BasicFunction<T,A>& residual_, bool fixedPoint_, T initialGuess_, T tolerance_, int maxIterations_): residual(residual_), fixedPoint(fixedPoint_), initialGuess(initialGuess_), tolerance(tolerance_), maxIterations(maxIterations_) {
+			if(tolerance < 0) {
+				tolerance = 256*std::numeric_limits<T>::epsilon();
+			}
+		}
+		virtual bool acceptsArgumentCount(int n) { return n == residual.inputCount() - 1; }
+		
+		//the residual's gradient is used for Newton steps and the implicit function theorem, so a mask that drops
+		//an input would silently zero a derivative (or divide by zero)
+		void checkResidualGradients() {
+			for(int i=0; i<residual.inputCount(); i++) {
+				if(!residual.requiresGradient(i)) {
+					throw "Solve operation requires gradients of its residual with respect to all of its inputs";
+				}
+			}
+		}
+
+		//iterate all n lanes at once, one batched call to the residual per iteration.
+		//lanes drop out as they converge; those that never do are left as NaN. returns whether they all converged
+		bool iterate(std::vector<const T*>& x, T* output, int n) {
+			if(!fixedPoint) {
+				checkResidualGradients();
+			}
+			int nParameters = x.size();
+			std::vector<int> active;
+			for(int i=0; i<n; i++) {
+				output[i] = initialGuess;
+				active.push_back(i);
+			}
+			std::vector<std::vector<T>> args;
+			for(int iteration=0; iteration<maxIterations && !active.empty(); iteration++) {
+				args.resize(active.size());
+				for(int a=0; a<(int)active.size(); a++) {
+					args[a].resize(nParameters + 1);
+					args[a][0] = output[active[a]];
+					for(int j=0; j<nParameters; j++) {
+						args[a][j+1] = x[j][active[a]];
+					}
+				}
+				std::vector<int> stillActive;
+				if(fixedPoint) {
+					std::vector<T> next = residual.evaluateBatch(args);
+					for(int a=0; a<(int)active.size(); a++) {
+						T y = output[active[a]];
+						output[active[a]] = next[a];
+						if(!(std::fabs(next[a] - y) <= tolerance*(1 + std::fabs(y)))) {
+							stillActive.push_back(active[a]);
+						}
+					}
+				} else {
+					std::vector<BasicValueAndGradient<T,A>> results = residual.differentiateBatch(args);
+					for(int a=0; a<(int)active.size(); a++) {
+						T y = output[active[a]];
+						T step = results[a].value/T(results[a].gradient[0]);
+						output[active[a]] = y - step;
+						if(!(std::fabs(results[a].value) <= tolerance || std::fabs(step) <= tolerance*(1 + std::fabs(y)))) {
+							stillActive.push_back(active[a]);
+						}
+					}
+				}
+				active = stillActive;
+			}
+			for(int i : active) {
+				output[i] = std::numeric_limits<T>::quiet_NaN();
+			}
+			return active.empty();
+		}
+
+		//dy/dp for each lane, in xDerivatives[j][i]; false if dF/dy makes the solve singular in some lane
+		bool parameterDerivatives(std::vector<const T*>& x, const T* output, std::vector<std::vector<A>>& xDerivatives, int n) {
+			checkResidualGradients();
+			int nParameters = x.size();
+			std::vector<std::vector<T>> args(n, std::vector<T>(nParameters + 1));
+			for(int i=0; i<n; i++) {
+				args[i][0] = output[i];
+				for(int j=0; j<nParameters; j++) {
+					args[i][j+1] = x[j][i];
+				}
+			}
+			std::vector<BasicValueAndGradient<T,A>> results = residual.differentiateBatch(args);
+			xDerivatives.assign(nParameters, std::vector<A>(n));
+			bool regular(true);
+			for(int i=0; i<n; i++) {
+				A dy = fixedPoint ? A(1) - results[i].gradient[0] : -results[i].gradient[0];
+				regular = regular && dy != 0;
+				for(int j=0; j<nParameters; j++) {
+					xDerivatives[j][i] = results[i].gradient[j+1]/dy;
+				}
+			}
+			return regular;
+		}
+
+		virtual T evaluate(std::vector<T>& x) {
+			if((int)x.size() != residual.inputCount() - 1) {
+				throw "Input to Solve Operation must have one argument per parameter of the residual";
+			}
+			std::vector<const T*> xPointers;
+			for(T& value : x) {
+				xPointers.push_back(&value);
+			}
+			T output;
+			if(!iterate(xPointers, &output, 1)) {
+				throw "Solve operation did not converge";
+			}
+			return output;
+		}
+		virtual std::vector<T> differentiate(std::vector<T>& x) {
+			return differentiateWithOutput(x, evaluate(x));
+		}
+		virtual std::vector<T> differentiateWithOutput(std::vector<T>& x, T output) {
+			std::vector<const T*> xPointers;
+			for(T& value : x) {
+				xPointers.push_back(&value);
+			}
+			std::vector<std::vector<A>> xDerivatives;
+			if(!parameterDerivatives(xPointers, &output, xDerivatives, 1)) {
+				throw "Solve operation can't differentiate at a singular point of the residual";
+			}
+			std::vector<T> derivatives;
+			for(std::vector<A>& xDerivative : xDerivatives) {
+				derivatives.push_back(T(xDerivative[0]));
+			}
+			return derivatives;
+		}
+		virtual void evaluateBatch(std::vector<const T*>& x, T* output, int n) {
+			iterate(x, output, n);
+		}
+		virtual void differentiateBatch(std::vector<const T*>& x, const T* output, const A* adjoint, std::vector<A*>& xAdjoints, int n) {
+			std::vector<std::vector<A>> xDerivatives;
+			parameterDerivatives(x, output, xDerivatives, n);
+			for(int j=0; j<(int)x.size(); j++) {
+				A* aj = xAdjoints[j];
+				for(int i=0; i<n; i++) {
+					aj[i] += adjoint[i] * xDerivatives[j][i];
+				}
+			}
+		}
+		//coefficient k of the residual's series is linear in y[k], with slope dF/dy: so with y[k] set to 0 it's r, and
+		//y[k] = -r/(dF/dy), or r/(1 - dF/dy) for a fixed point. that's a Taylor pass of the residual per coefficient,
+		//O(order^3) in all rather than O(order^2)
+		virtual void taylor(std::vector<const T*>& x, T* output, int order) {
+			checkResidualGradients();
+			int nParameters = x.size();
+			std::vector<std::vector<T>> point(1, std::vector<T>(nParameters + 1));
+			point[0][0] = output[0];
+			for(int j=0; j<nParameters; j++) {
+				point[0][j+1] = x[j][0];
+			}
+			T dy = T(residual.differentiateBatch(point)[0].gradient[0]);
+			dy = fixedPoint ? T(1) - dy : -dy;
+			std::vector<std::vector<T>> coefficients(nParameters + 1);
+			for(int j=0; j<=nParameters; j++) {
+				coefficients[j].push_back(point[0][j]);
+			}
+			for(int k=1; k<=order; k++) {
+				coefficients[0].push_back(T(0));
+				for(int j=0; j<nParameters; j++) {
+					coefficients[j+1].push_back(x[j][k]);
+				}
+				output[k] = residual.taylor(coefficients)[k]/dy;
+				coefficients[0][k] = output[k];
+			}
+		}
+	};
+
+	//y with residual(y, parameters...) = 0, found by Newton's method from initialGuess
+	template<typename T, typename A>
+	BasicNode<T,A>& solve(const BasicFunction<T,A>& residual, std::vector<BasicNode<T,A>*> parameters, typename BasicNode<T,A>::Scalar initialGuess, typename BasicNode<T,A>::Scalar tolerance = -1, int maxIterations = 100) {
+		return makeNode<T,A>(parameters, new Solve<T,A>(residual, false, initialGuess, tolerance, maxIterations));
+	}
+
+	//y with map(y, parameters...) = y, found by iterating the map from initialGuess
+	template<typename T, typename A>
+	BasicNode<T,A>& fixedPoint(const BasicFunction<T,A>& map, std::vector<BasicNode<T,A>*> parameters, typename BasicNode<T,A>::Scalar initialGuess, typename BasicNode<T,A>::Scalar tolerance = -1, int maxIterations = 1000) {
+		return makeNode<T,A>(parameters, new Solve<T,A>(map, true, initialGuess, tolerance, maxIterations));
+	}
+};
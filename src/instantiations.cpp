@@ -0,0 +1,3 @@
+//instantiates every template of the library for every supported scalar type, so that the build checks they all compile
+#define AD_INSTANTIATE_ALL
+#include "autoDiff.h"
@@ -0,0 +1,103 @@
+//evaluateBatch and differentiateBatch against the scalar evaluate and differentiate, and EvaluationService
+#include "evaluationService.h"
+#include "check.h"
+
+using namespace std;
+
+void checkBatch() {
+	ad::Node x1, x2, x3;
+	ad::Node& n1 = (4 + 2*x1 + 3*x2 - 5*x3)/(x1 + x3);
+	ad::Node& n2 = exp(x1/x2);
+	ad::Node& n3 = n2 + n1*n2;
+	ad::Node output = log(n1*n1*n3*n3)/2 - x3;
+	ad::Function f({&x1, &x2, &x3});
+	vector<vector<double>> points;
+	for(int b=0; b<37; b++) {
+		points.push_back({0.5 + 0.05*b, 1.3 - 0.01*b, -0.4 + 0.02*b});
+	}
+	for(int checked=1; checked>=0; checked--) {
+		f.setChecked(checked == 1);
+		vector<double> values = f.evaluateBatch(points);
+		vector<ad::ValueAndGradient> results = f.differentiateBatch(points);
+		CHECK(values.size() == points.size() && results.size() == points.size());
+		for(int b=0; b<(int)points.size(); b++) {
+			double value = f.evaluate(points[b]);
+			vector<double> gradient = f.differentiate(points[b]);
+			CHECK_NEAR(values[b], value, 1e-14);
+			CHECK_NEAR(results[b].value, value, 1e-14);
+			for(int i=0; i<3; i++) {
+				CHECK_NEAR(results[b].gradient[i], gradient[i], 1e-12);
+			}
+		}
+	}
+	
+	//the batched methods run the kernels in either mode, so dividing by zero is reported rather than thrown
+	f.setChecked(true);
+	ad::NumericalStatus status;
+	CHECK(!std::isfinite(f.differentiateBatch({points[0], {1.0, 1.0, -1.0}}, &status)[1].value));
+	CHECK(!status.finite && status.point == 1);
+	CHECK_THROWS(f.evaluate({1.0, 1.0, -1.0}));
+	CHECK_THROWS(f.evaluateBatch({{1.0, 2.0}}));
+}
+
+void checkEvaluationService() {
+	ad::Node a, b;
+	ad::Node output = log(a)*b;
+	ad::Function f({&a, &b});
+	CHECK_THROWS(ad::EvaluationService(f, chrono::microseconds(100), 0));
+
+	//requests from many threads at once all get their own answers
+	{
+		ad::EvaluationService service(f, chrono::microseconds(500), 16);
+		vector<thread> clients;
+		vector<int> wrong(4, 0);
+		for(int t=0; t<4; t++) {
+			clients.push_back(thread([&, t]() {
+				for(int r=0; r<200; r++) {
+					double x = 1 + t + 0.01*r;
+					ad::ValueAndGradient result = service.submit({x, 2.0}).get();
+					if(!check::near(result.value, 2*log(x), 1e-14) || !check::near(result.gradient[0], 2/x, 1e-14)) {
+						wrong[t]++;
+					}
+				}
+			}));
+		}
+		for(thread& client : clients) {
+			client.join();
+		}
+		for(int t=0; t<4; t++) {
+			CHECK(wrong[t] == 0);
+		}
+		CHECK_THROWS(service.submit({1.0}));
+	}
+
+	//a bad point fails its own request, not the rest of its batch
+	{
+		ad::EvaluationService service(f, chrono::milliseconds(20));
+		future<ad::ValueAndGradient> good = service.submit({1.0, 2.0});
+		future<ad::ValueAndGradient> bad = service.submit({-1.0, 2.0});
+		future<ad::ValueAndGradient> alsoGood = service.submit({exp(1.0), 3.0});
+		ad::ValueAndGradient result = good.get();
+		CHECK(result.value == 0.0 && result.gradient[0] == 2.0);
+		CHECK_NEAR(alsoGood.get().gradient[0], 3.0/exp(1.0), 1e-15);
+		CHECK_THROWS(bad.get());
+	}
+	//unchecked, it just gets the NaN
+	f.setChecked(false);
+	ad::EvaluationService service(f, chrono::milliseconds(20));
+	future<ad::ValueAndGradient> bad = service.submit({-1.0, 2.0});
+	future<ad::ValueAndGradient> good = service.submit({1.0, 2.0});
+	CHECK(std::isnan(bad.get().value));
+	CHECK(good.get().value == 0.0);
+}
+
+int main() {
+	try {
+		checkBatch();
+		checkEvaluationService();
+	} catch(const char* e) {
+		cerr << "unexpected exception: " << e << "\n";
+		return 1;
+	}
+	return check::result();
+}
@@ -0,0 +1,109 @@
+//n-ary sum and product nodes, and chains of Add and Multiply flattened into them
+#include "autoDiff.h"
+#include "check.h"
+
+using namespace std;
+
+void checkSumAndProduct() {
+	ad::Node x, y, z;
+	ad::Node output = ad::sum({&x, &y, &z}) * ad::product({&x, &y, &z});
+	ad::Function f({&x, &y, &z});
+	vector<double> point = {0.7, 1.3, -0.4};
+	vector<double> gradient = f.differentiate(point);
+	vector<double> differences = check::finiteDifferences(f, point);
+	for(int i=0; i<3; i++) {
+		CHECK_NEAR(gradient[i], differences[i], 1e-6);
+	}
+	//a product with a zero factor still has the right partials
+	gradient = f.differentiate({0.0, 2.0, 3.0});
+	CHECK(gradient[0] == 5.0*6.0 && gradient[1] == 0.0 && gradient[2] == 0.0);
+	f.setChecked(false);
+	CHECK(f.differentiate({0.0, 2.0, 3.0}) == gradient);
+}
+
+//constants anywhere in a chain end up folded into the one node
+void checkChains() {
+	ad::Node w, x, y, z;
+	ad::Node output = ((w + 1.0) + x + 2.0 + y) * 3.0 * z * (y*2.0);
+	ad::Function f({&w, &x, &y, &z});
+	CHECK(f.nodeCount() == 6); //the inputs, one sum and one product, which y*2 is folded into as well
+	vector<double> point = {0.5, -1.5, 2.0, 0.25};
+	CHECK_NEAR(f.evaluate(point), 4.0*3.0*0.25*4.0, 1e-15);
+	vector<double> gradient = f.differentiate(point);
+	vector<double> differences = check::finiteDifferences(f, point);
+	for(int i=0; i<4; i++) {
+		CHECK_NEAR(gradient[i], differences[i], 1e-6);
+	}
+	f.setChecked(false);
+	vector<ad::ValueAndGradient> batch = f.differentiateBatch({point});
+	for(int i=0; i<4; i++) {
+		CHECK_NEAR(batch[0].gradient[i], gradient[i], 1e-14);
+	}
+}
+
+//flattening only changes the Function's tape: nodes the user holds keep their values and derivatives
+void checkIntermediates() {
+	ad::Node x, y, z;
+	ad::Node& t = x*y;
+	ad::Node output = t*z + 1.0;
+	ad::Function f({&x, &y, &z});
+	CHECK(f.nodeCount() == 5);
+	for(int checked=1; checked>=0; checked--) {
+		f.setChecked(checked == 1);
+		CHECK(f.evaluate({2.0, 3.0, 4.0}) == 25.0);
+		CHECK(t.getValue() == 6.0);
+		vector<double> gradient = f.differentiate({2.0, 3.0, 4.0});
+		CHECK(gradient == vector<double>({12.0, 8.0, 6.0}));
+		CHECK(t.getValue() == 6.0 && t.getDerivative() == 4.0);
+		//outside the gradient cone it's left at 0, like any other node
+		f.setRequiresGradient({false, false, true});
+		CHECK(f.differentiate({2.0, 3.0, 4.0})[2] == 6.0);
+		CHECK(t.getDerivative() == 0.0);
+		f.setRequiresGradient({true, true, true});
+	}
+	
+	//chains built in a graph are flattened too
+	ad::Graph graph;
+	ad::Node& a = graph.input();
+	ad::Node& b = graph.input();
+	ad::Node& c = graph.input();
+	ad::Node& partial = a + b;
+	partial + c + 1.0;
+	ad::Function g({&a, &b, &c});
+	CHECK(g.nodeCount() == 4);
+	CHECK(g.evaluate({1.0, 2.0, 3.0}) == 7.0);
+	CHECK(partial.getValue() == 3.0);
+}
+
+//s += x[i] over many terms stays linear, and gives one wide sum
+void checkAccumulation() {
+	int n = 2000;
+	vector<ad::Node> x(n);
+	ad::Node s = x[0]*1.0;
+	for(int i=1; i<n; i++) {
+		s += x[i];
+	}
+	s *= 2.0;
+	vector<ad::Node*> inputs;
+	for(ad::Node& input : x) {
+		inputs.push_back(&input);
+	}
+	ad::Function f(inputs);
+	vector<double> args(n, 0.5);
+	CHECK_NEAR(f.evaluate(args), n, 1e-12);
+	vector<double> gradient = f.differentiate(args);
+	CHECK(gradient[0] == 2.0 && gradient[n-1] == 2.0);
+}
+
+int main() {
+	try {
+		checkSumAndProduct();
+		checkChains();
+		checkIntermediates();
+		checkAccumulation();
+	} catch(const char* e) {
+		cerr << "unexpected exception: " << e << "\n";
+		return 1;
+	}
+	return check::result();
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+//a minimal harness for the tests: a failed check prints where it was, and main returns check::result()
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace check {
+	inline int& failures() {
+		static int count = 0;
+		return count;
+	}
+	inline void report(bool passed, const char* what, const char* file, int line) {
+		if(!passed) {
+			std::cerr << file << ":" << line << ": check failed: " << what << "\n";
+			failures()++;
+		}
+	}
+	//relative to the size of expected, and absolute near 0
+	inline bool near(double actual, double expected, double tolerance) {
+		return std::fabs(actual - expected) <= tolerance*(1 + std::fabs(expected));
+	}
+	//central differences of f.evaluate at point, one per input
+	template<typename F>
+	std::vector<double> finiteDifferences(F& f, const std::vector<double>& point) {
+		std::vector<double> differences;
+		for(int i=0; i<(int)point.size(); i++) {
+			std::vector<double> plus(point), minus(point);
+			double h = 1e-6*(1 + std::fabs(point[i]));
+			plus[i] += h;
+			minus[i] -= h;
+			differences.push_back((f.evaluate(plus) - f.evaluate(minus))/(2*h));
+		}
+		return differences;
+	}
+	inline int result() {
+		if(failures() > 0) {
+			std::cerr << failures() << " checks failed\n";
+			return 1;
+		}
+		return 0;
+	}
+};
+
+#define CHECK(condition) check::report((condition), #condition, __FILE__, __LINE__)
+#define CHECK_NEAR(actual, expected, tolerance) check::report(check::near((actual), (expected), (tolerance)), #actual " near " #expected, __FILE__, __LINE__)
+//variadic so that the statement may have commas in it
+#define CHECK_THROWS(...) \
+	do { \
+		bool threw = false; \
+		try { __VA_ARGS__; } catch(const char*) { threw = true; } \
+		check::report(threw, "throws: " #__VA_ARGS__, __FILE__, __LINE__); \
+	} while(0)
@@ -0,0 +1,82 @@
+//user-defined operations through ad::apply, and forward mode against the reverse-mode gradient
+#include "autoDiff.h"
+#include "check.h"
+
+using namespace std;
+
+//x*y with span kernels; jvp is only provided when withJvp is set
+struct Product: ad::CustomOperation {
+	bool withJvp;
+	Product(bool withJvp_): withJvp(withJvp_) {}
+	virtual int arity() { return 2; }
+	virtual void forward(const vector<Values>& inputs, ad::Span<double> output) {
+		for(int i=0; i<output.size(); i++) {
+			output[i] = inputs[0][i]*inputs[1][i];
+		}
+	}
+	virtual void vjp(const vector<Values>& inputs, Values output, ad::Span<const double> adjoint, const vector<ad::Span<double>>& inputAdjoints) {
+		for(int i=0; i<output.size(); i++) {
+			inputAdjoints[0][i] += adjoint[i]*inputs[1][i];
+			inputAdjoints[1][i] += adjoint[i]*inputs[0][i];
+		}
+	}
+	virtual bool jvp(const vector<Values>& inputs, Values output, const vector<ad::Span<const double>>& tangents, ad::Span<double> outputTangent) {
+		if(!withJvp) {
+			return false;
+		}
+		for(int i=0; i<output.size(); i++) {
+			outputTangent[i] = tangents[0][i]*inputs[1][i] + inputs[0][i]*tangents[1][i];
+		}
+		return true;
+	}
+};
+
+//x*z^2, from scalar code only
+ad::ScalarOperation* scalar() {
+	return new ad::ScalarOperation(
+		[](const vector<double>& v) { return v[0]*v[1]*v[1]; },
+		[](const vector<double>& v, double) { return vector<double>{v[1]*v[1], 2*v[0]*v[1]}; }, 2);
+}
+
+void checkCustom() {
+	for(int withJvp=0; withJvp<2; withJvp++) {
+		ad::Node x, y, z;
+		ad::Node& product = ad::apply({&x, &y}, new Product(withJvp == 1));
+		ad::Node output = tanh(product) + ad::apply({&x, &z}, scalar()) + exp(y);
+		ad::Function f({&x, &y, &z});
+		vector<vector<double>> points = {{0.7, 1.3, -0.4}, {1.1, 0.6, 0.9}};
+		vector<double> direction = {0.3, -0.2, 0.5};
+		for(int checked=1; checked>=0; checked--) {
+			f.setChecked(checked == 1);
+			vector<double> directional = f.directionalDerivativeBatch(points, {direction, direction});
+			for(int b=0; b<(int)points.size(); b++) {
+				vector<double> gradient = f.differentiate(points[b]);
+				vector<double> differences = check::finiteDifferences(f, points[b]);
+				double expected = 0;
+				for(int i=0; i<3; i++) {
+					CHECK_NEAR(gradient[i], differences[i], 1e-6);
+					expected += gradient[i]*direction[i];
+				}
+				CHECK_NEAR(directional[b], expected, 1e-13);
+				CHECK_NEAR(f.directionalDerivative(points[b], direction), expected, 1e-13);
+			}
+		}
+	}
+}
+
+void checkArity() {
+	ad::Node x, y, z;
+	CHECK_THROWS(ad::apply({&x, &y, &z}, new Product(false)));
+	CHECK_THROWS(ad::apply({&x}, scalar()));
+}
+
+int main() {
+	try {
+		checkCustom();
+		checkArity();
+	} catch(const char* e) {
+		cerr << "unexpected exception: " << e << "\n";
+		return 1;
+	}
+	return check::result();
+}
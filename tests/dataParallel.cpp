@@ -0,0 +1,108 @@
+//DataParallelRunner: sums match the serial path, and failures in workers are contained
+#include "dataParallel.h"
+#include "check.h"
+#include <cstdlib>
+#include <stdexcept>
+
+using namespace std;
+
+//x*x, or a failure for the points that ask for one
+ad::ScalarOperation* square() {
+	return new ad::ScalarOperation([](const vector<double>& v) -> double {
+		if(v[0] > 5) {
+			throw runtime_error(v[0] > 6 ? "much too big" : "too big");
+		}
+		if(v[0] < -5) {
+			abort();
+		}
+		return v[0]*v[0];
+	}, [](const vector<double>& v, double) { return vector<double>{2*v[0]}; }, 1);
+}
+
+void checkSums() {
+	ad::Node w, x;
+	ad::Node output = ad::apply({&x}, square())*w;
+	ad::Function f({&w, &x});
+	vector<vector<double>> points;
+	for(int i=0; i<1000; i++) {
+		points.push_back({0.0, (i%9)*0.5});
+	}
+	for(double weight : {1.5, -0.5}) {
+		double value = 0, gradient = 0, xGradient = 0;
+		for(const vector<double>& point : points) {
+			ad::ValueAndGradient serial = f.differentiateBatch({{weight, point[1]}})[0];
+			value += serial.value;
+			gradient += serial.gradient[0];
+			xGradient += serial.gradient[1];
+		}
+		for(int nWorkers : {1, 3}) {
+			ad::DataParallelRunner runner(f, points, nWorkers, {0}, 64);
+			for(int call=0; call<2; call++) {
+				ad::ValueAndGradient sum = runner.differentiateSum({weight});
+				CHECK_NEAR(sum.value, value, 1e-12);
+				CHECK_NEAR(sum.gradient[0], gradient, 1e-12);
+				CHECK_NEAR(sum.gradient[1], xGradient, 1e-12);
+			}
+		}
+	}
+	//fewer points than workers leaves some with nothing to do
+	vector<vector<double>> few(points.begin(), points.begin() + 2);
+	ad::DataParallelRunner runner(f, few, 4, {0});
+	CHECK_NEAR(runner.differentiateSum({1.0}).value, 0.25, 1e-15);
+
+	CHECK_THROWS(ad::DataParallelRunner(f, points, 0));
+	CHECK_THROWS(ad::DataParallelRunner(f, points, 2, {2}));
+	CHECK_THROWS(ad::DataParallelRunner(f, {{1.0}}, 2));
+	ad::DataParallelRunner parameterless(f, few, 2);
+	CHECK_THROWS(parameterless.differentiateSum({1.0}));
+}
+
+void checkFailures() {
+	ad::Node w, x;
+	ad::Node output = ad::apply({&x}, square())*w;
+	ad::Function f({&w, &x});
+	vector<vector<double>> points(100, vector<double>{0.0, 1.0});
+
+	//an exception in a worker is reported, and the runner keeps working
+	points.push_back({0.0, 6.0});
+	{
+		ad::DataParallelRunner runner(f, points, 2, {0});
+		CHECK_THROWS(runner.differentiateSum({1.0}));
+		CHECK(runner.error() == "too big");
+		CHECK_THROWS(runner.differentiateSum({1.0}));
+	}
+	//when several fail at once, one of their messages is reported whole
+	points.insert(points.begin(), {0.0, 7.0});
+	{
+		ad::DataParallelRunner runner(f, points, 2, {0});
+		for(int call=0; call<20; call++) {
+			CHECK_THROWS(runner.differentiateSum({1.0}));
+			CHECK(runner.error() == "too big" || runner.error() == "much too big");
+		}
+	}
+	points.erase(points.begin());
+	points.pop_back();
+	{
+		ad::DataParallelRunner runner(f, points, 2, {0});
+		CHECK_NEAR(runner.differentiateSum({2.0}).value, 200.0, 1e-12);
+	}
+
+	//a worker that dies is noticed instead of hanging, and the runner can't be used after that
+	points.push_back({0.0, -7.0});
+	{
+		ad::DataParallelRunner runner(f, points, 2, {0});
+		CHECK_THROWS(runner.differentiateSum({1.0}));
+		CHECK_THROWS(runner.differentiateSum({1.0}));
+	}
+}
+
+int main() {
+	try {
+		checkSums();
+		checkFailures();
+	} catch(const char* e) {
+		cerr << "unexpected exception: " << e << "\n";
+		return 1;
+	}
+	return check::result();
+}
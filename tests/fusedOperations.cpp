@@ -0,0 +1,96 @@
+//the fused operations: gradients against finite differences, their batched kernels against the scalar code,
+//and softmax built on a shared logSumExp node
+#include "autoDiff.h"
+#include "check.h"
+#include <functional>
+#include <string>
+
+using namespace std;
+
+struct Case {
+	string name;
+	function<ad::Node&(ad::Node&, ad::Node&, ad::Node&)> build;
+};
+
+vector<Case> cases() {
+	return {
+		{"logSumExp", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return ad::logSumExp({&x, &y, &z}); }},
+		{"softmax", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return ad::softmax({&x, &y, &z}, 1)*2.0 + ad::softmax({&x, &y, &z}, 2); }},
+		{"shared softmax", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& {
+			ad::Node& lse = ad::logSumExp({&x, &y, &z});
+			return ad::softmax(y, lse)*2.0 + ad::softmax(z, lse);
+		}},
+		{"sigmoid", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return sigmoid(x*y) + z; }},
+		{"softplus", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return softplus(x - y) + z; }},
+		{"pow", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return pow(x, y) + pow(y, 2.5) + pow(z, 2.0) + pow(2.0, x); }},
+		{"sqrt", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return sqrt(x + y) + z; }},
+		{"tanh", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return tanh(x - z) + y; }},
+	};
+}
+
+void checkCase(const Case& c) {
+	ad::Graph graph;
+	ad::Node& x = graph.input();
+	ad::Node& y = graph.input();
+	ad::Node& z = graph.input();
+	c.build(x, y, z);
+	ad::Function f({&x, &y, &z});
+	vector<vector<double>> points = {{0.7, 1.3, -0.4}, {1.1, 0.6, 0.9}, {2.0, 1.7, 0.2}};
+	vector<ad::ValueAndGradient> batch = f.differentiateBatch(points); //the kernels, against the checked scalar code below
+	for(int b=0; b<(int)points.size(); b++) {
+		double value = f.evaluate(points[b]);
+		vector<double> gradient = f.differentiate(points[b]);
+		vector<double> differences = check::finiteDifferences(f, points[b]);
+		CHECK_NEAR(batch[b].value, value, 1e-14);
+		for(int i=0; i<3; i++) {
+			if(!check::near(gradient[i], differences[i], 1e-6)) {
+				cerr << c.name << ", input " << i << ": " << gradient[i] << " vs finite difference " << differences[i] << "\n";
+			}
+			CHECK_NEAR(gradient[i], differences[i], 1e-6);
+			CHECK_NEAR(batch[b].gradient[i], gradient[i], 1e-12);
+		}
+	}
+}
+
+//large inputs mustn't overflow, and the components of a softmax add up to 1
+void checkStability() {
+	ad::Node x, y;
+	ad::Node& lse = ad::logSumExp({&x, &y});
+	ad::Node output = ad::softmax(x, lse) + ad::softmax(y, lse);
+	ad::Function f({&x, &y});
+	for(int checked=1; checked>=0; checked--) {
+		f.setChecked(checked == 1);
+		//x - lse loses about 1000 ulps when lse is near 1000
+		CHECK_NEAR(f.evaluate({1000.0, 999.0}), 1.0, 1e-12);
+		vector<double> gradient = f.differentiate({1000.0, 999.0});
+		CHECK(fabs(gradient[0]) < 1e-12 && fabs(gradient[1]) < 1e-12);
+		CHECK_NEAR(lse.getValue(), 1000 + log(1 + exp(-1.0)), 1e-15);
+	}
+	ad::Node a, b;
+	ad::Node s = softplus(a) + sigmoid(b);
+	ad::Function g({&a, &b});
+	CHECK_NEAR(g.evaluate({800.0, -800.0}), 800.0, 1e-15);
+	CHECK(g.status().finite);
+}
+
+void checkDomainErrors() {
+	ad::Node x;
+	ad::Node y = sqrt(x);
+	ad::Function f({&x});
+	CHECK_THROWS(f.evaluate({-1.0}));
+	CHECK_THROWS(ad::softmax({&x}, 1));
+}
+
+int main() {
+	try {
+		for(const Case& c : cases()) {
+			checkCase(c);
+		}
+		checkStability();
+		checkDomainErrors();
+	} catch(const char* e) {
+		cerr << "unexpected exception: " << e << "\n";
+		return 1;
+	}
+	return check::result();
+}
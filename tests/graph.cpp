@@ -0,0 +1,76 @@
+//lifetimes of nodes, graphs and the links between them. most of these are for the sanitizers' benefit
+#include "autoDiff.h"
+#include "check.h"
+
+using namespace std;
+
+void checkMixing() {
+	ad::Node free;
+	{
+		ad::Graph graph;
+		ad::Node& p = graph.input();
+		CHECK_THROWS(free*p);
+		CHECK_THROWS(p + free);
+		CHECK_THROWS(ad::Node copy(p));
+		ad::Node named;
+		CHECK_THROWS(named = p);
+		ad::Graph other;
+		ad::Node& q = other.input();
+		CHECK_THROWS(p*q);
+	}
+	//the graph is gone, and free must not have been linked into it
+	ad::Node y = free*3;
+	ad::Function f({&free});
+	CHECK(f.evaluate({2.0}) == 6.0);
+}
+
+void checkClear() {
+	ad::Graph graph;
+	for(int round=0; round<3; round++) {
+		ad::Node& x = graph.input();
+		ad::Node* current = &x;
+		for(int i=0; i<3000; i++) {
+			current = &(tanh(*current)*0.5 + x);
+		}
+		ad::Function f({&x});
+		CHECK(f.evaluate({0.0}) == 0.0);
+		CHECK(graph.nodeCount() > 9000);
+		graph.clear();
+		CHECK(graph.nodeCount() == 0);
+	}
+}
+
+//long chains of free-standing nodes, torn down through their single named output. the second shares its input
+//with every link, which is the case that used to be quadratic
+void checkTeardown() {
+	ad::Node x;
+	for(int shared=0; shared<2; shared++) {
+		ad::Node* output = nullptr;
+		{
+			ad::Node* current = &(x*0.5);
+			for(int i=0; i<100000; i++) {
+				current = shared ? &(*current*0.5 + x) : &(*current + 1.0);
+			}
+			output = new ad::Node(*current);
+		}
+		ad::Function f({&x});
+		CHECK(f.evaluate({2.0}) == (shared ? 4.0 : 100001.0));
+		delete output;
+	}
+	//x is unlinked from everything that was deleted
+	ad::Node z = exp(x);
+	ad::Function g({&x});
+	CHECK(g.evaluate({0.0}) == 1.0);
+}
+
+int main() {
+	try {
+		checkMixing();
+		checkClear();
+		checkTeardown();
+	} catch(const char* e) {
+		cerr << "unexpected exception: " << e << "\n";
+		return 1;
+	}
+	return check::result();
+}
@@ -0,0 +1,84 @@
+//gradients of the basic operations against central finite differences, and the node operators
+#include "autoDiff.h"
+#include "check.h"
+#include <functional>
+#include <string>
+
+using namespace std;
+
+struct Case {
+	string name;
+	function<ad::Node&(ad::Node&, ad::Node&, ad::Node&)> build;
+};
+
+vector<Case> cases() {
+	return {
+		{"add", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return x + y + 2.0 + z; }},
+		{"subtract", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return (x - y)*(1.0 - z)*(z - 2.0); }},
+		{"multiply", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return 3.0*x*y*z*x; }},
+		{"divide", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return x/y + 2.0/x + z/4.0; }},
+		{"log", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return log(x*y) + log(y, 3.0) + z; }},
+		{"exp", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return exp(x*z) + y; }},
+		{"example", [](ad::Node& x1, ad::Node& x2, ad::Node& x3) -> ad::Node& {
+			ad::Node& n1 = (4 + 2*x1 + 3*x2 - 5*x3)/(x1 + x3);
+			ad::Node& n2 = exp(x1/x2);
+			ad::Node& n3 = n2 + n1*n2;
+			return log(n1*n1*n3*n3)/2;
+		}},
+	};
+}
+
+void checkGradients() {
+	vector<vector<double>> points = {{0.7, 1.3, -0.4}, {1.1, 0.6, 0.9}, {2.0, 1.7, 0.2}};
+	for(const Case& c : cases()) {
+		ad::Graph graph;
+		ad::Node& x = graph.input();
+		ad::Node& y = graph.input();
+		ad::Node& z = graph.input();
+		c.build(x, y, z);
+		ad::Function f({&x, &y, &z});
+		for(const vector<double>& point : points) {
+			vector<double> gradient = f.differentiate(point);
+			vector<double> differences = check::finiteDifferences(f, point);
+			for(int i=0; i<3; i++) {
+				if(!check::near(gradient[i], differences[i], 1e-6)) {
+					cerr << c.name << ", input " << i << ": " << gradient[i] << " vs finite difference " << differences[i] << "\n";
+				}
+				CHECK_NEAR(gradient[i], differences[i], 1e-6);
+			}
+		}
+	}
+}
+
+//free-standing nodes, reassigned along the way
+void checkAssignment() {
+	ad::Node a, b;
+	ad::Node c = a*b;
+	c = c + a;
+	c *= 2.0;
+	ad::Function f({&a, &b});
+	vector<double> gradient = f.differentiate({3.0, 4.0});
+	CHECK(f.evaluate({3.0, 4.0}) == 30.0);
+	CHECK(gradient[0] == 10.0 && gradient[1] == 6.0);
+	CHECK(c.getValue() == 30.0 && a.getDerivative() == 10.0);
+}
+
+void checkDomainErrors() {
+	ad::Node x;
+	ad::Node y = log(x);
+	ad::Function f({&x});
+	CHECK_THROWS(f.evaluate({-1.0}));
+	CHECK_THROWS(f.evaluate({1.0, 2.0}));
+}
+
+int main() {
+	try {
+		checkGradients();
+		checkAssignment();
+		checkDomainErrors();
+	} catch(const char* e) {
+		cerr << "unexpected exception: " << e << "\n";
+		return 1;
+	}
+	return check::result();
+}
@@ -0,0 +1,52 @@
+//the profiler's counts for a known sequence of calls, and its two output formats
+#define AD_PROFILE
+#include "autoDiff.h"
+#include "check.h"
+#include <sstream>
+
+AD_PROFILE_COUNT_ALLOCATIONS
+
+using namespace std;
+
+int main() {
+	try {
+		ad::Node x, y;
+		ad::Node output = exp(x)*y;
+		ad::Function f({&x, &y});
+		f.setName("profiled");
+		CHECK(f.getName() == "profiled");
+		ad::profiling::profiler().reset();
+		for(int i=0; i<3; i++) {
+			f.evaluate({0.5, 2.0});
+		}
+		for(int i=0; i<2; i++) {
+			f.differentiate({0.5, 2.0});
+		}
+		f.evaluateBatch({{0.5, 2.0}, {1.0, 3.0}});
+
+		//differentiate's inner forward pass is folded into its own call
+		ad::profiling::FunctionStats function = ad::profiling::profiler().functionStats("profiled");
+		CHECK(function.calls == 6);
+		CHECK(function.nodes == f.nodeCount());
+		CHECK(function.seconds > 0);
+		CHECK(function.allocations > 0);
+		ad::profiling::OperationStats exp = ad::profiling::profiler().operationStats("Exp");
+		CHECK(exp.forwardCalls == 6 && exp.backwardCalls == 2);
+		CHECK(exp.forwardPoints == 7 && exp.backwardPoints == 2);
+		CHECK(ad::profiling::profiler().operationStats("Log").forwardCalls == 0);
+
+		ostringstream summary, trace;
+		ad::profiling::profiler().writeSummary(summary);
+		ad::profiling::profiler().writeChromeTrace(trace);
+		CHECK(summary.str().find("profiled") != string::npos && summary.str().find("Exp") != string::npos);
+		CHECK(trace.str().find("{\"traceEvents\":[") == 0);
+		CHECK(trace.str().find("\"profiled evaluate\"") != string::npos);
+
+		ad::profiling::profiler().reset();
+		CHECK(ad::profiling::profiler().functionStats("profiled").calls == 0);
+	} catch(const char* e) {
+		cerr << "unexpected exception: " << e << "\n";
+		return 1;
+	}
+	return check::result();
+}
@@ -0,0 +1,72 @@
+//the requires-gradient mask: masked inputs get 0, the rest of the gradient is unchanged, in every path.
+//also empty batches
+#include "autoDiff.h"
+#include "check.h"
+
+using namespace std;
+
+void checkMask() {
+	ad::Node x, y, z;
+	ad::Node& data = exp(y)*z; //only depends on inputs that will be masked
+	ad::Node output = tanh(x*data) + log(x) + data;
+	ad::Function f({&x, &y, &z});
+	vector<double> point = {0.7, 0.3, -0.4};
+	vector<double> full = f.differentiate(point);
+	CHECK(f.requiresGradient(1));
+
+	f.setRequiresGradient({true, false, false});
+	CHECK(!f.requiresGradient(1));
+	for(int checked=1; checked>=0; checked--) {
+		f.setChecked(checked == 1);
+		vector<double> masked = f.differentiate(point);
+		CHECK_NEAR(masked[0], full[0], 1e-15);
+		CHECK(masked[1] == 0 && masked[2] == 0);
+		//nodes outside the gradient cone are left at 0
+		CHECK(data.getDerivative() == 0 && y.getDerivative() == 0);
+		vector<ad::ValueAndGradient> batch = f.differentiateBatch({point, point});
+		CHECK_NEAR(batch[1].gradient[0], full[0], 1e-15);
+		CHECK(batch[1].gradient[1] == 0 && batch[1].gradient[2] == 0);
+	}
+
+	//nothing requires a gradient: the value is still computed
+	f.setRequiresGradient(0, false);
+	vector<ad::ValueAndGradient> none = f.differentiateBatch({point});
+	CHECK_NEAR(none[0].value, f.evaluate(point), 1e-15);
+	CHECK(none[0].gradient == vector<double>(3, 0.0));
+
+	f.setRequiresGradient({true, true, true});
+	vector<double> again = f.differentiate(point);
+	for(int i=0; i<3; i++) {
+		CHECK_NEAR(again[i], full[i], 1e-15);
+	}
+	CHECK_THROWS(f.setRequiresGradient({true, false}));
+	CHECK_THROWS(f.setRequiresGradient(3, true));
+}
+
+void checkEmptyBatches() {
+	ad::Node x, y;
+	ad::Node output = sqrt(x) + log(y);
+	ad::Function f({&x, &y});
+	for(int checked=1; checked>=0; checked--) {
+		f.setChecked(checked == 1);
+		ad::NumericalStatus status;
+		CHECK(f.differentiateBatch({}, &status).empty());
+		CHECK(f.evaluateBatch({}, &status).empty());
+		CHECK(f.directionalDerivativeBatch({}, {}).empty());
+		CHECK(status.finite);
+		f.setRequiresGradient({false, false});
+		CHECK(f.differentiateBatch({}).empty());
+		f.setRequiresGradient({true, true});
+	}
+}
+
+int main() {
+	try {
+		checkMask();
+		checkEmptyBatches();
+	} catch(const char* e) {
+		cerr << "unexpected exception: " << e << "\n";
+		return 1;
+	}
+	return check::result();
+}
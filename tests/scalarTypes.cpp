@@ -0,0 +1,59 @@
+//the same graph in each scalar type agrees with the double version to that type's precision
+#include "autoDiff.h"
+#include "check.h"
+#include <limits>
+
+using namespace std;
+
+template<typename T, typename A>
+ad::BasicNode<T,A>& build(ad::BasicNode<T,A>& x1, ad::BasicNode<T,A>& x2, ad::BasicNode<T,A>& x3) {
+	ad::BasicNode<T,A>& n1 = (4 + 2*x1 + 3*x2 - 5*x3)/(x1 + x3);
+	ad::BasicNode<T,A>& n2 = exp(x1/x2);
+	ad::BasicNode<T,A>& n3 = n2 + n1*n2;
+	return log(n1*n1*n3*n3)/2 + tanh(x3)*sigmoid(x2);
+}
+
+//value and gradient of the graph in type T (derivatives in A) at point, in double
+template<typename T, typename A>
+vector<double> run(const vector<double>& point, bool checked) {
+	ad::BasicGraph<T,A> graph;
+	ad::BasicNode<T,A>& x1 = graph.input();
+	ad::BasicNode<T,A>& x2 = graph.input();
+	ad::BasicNode<T,A>& x3 = graph.input();
+	build(x1, x2, x3);
+	ad::BasicFunction<T,A> f({&x1, &x2, &x3});
+	f.setChecked(checked);
+	vector<T> args(point.begin(), point.end());
+	vector<double> result{double(f.evaluate(args))};
+	vector<A> gradient = f.differentiate(args);
+	vector<ad::BasicValueAndGradient<T,A>> batch = f.differentiateBatch({args});
+	for(int i=0; i<3; i++) {
+		CHECK_NEAR(double(batch[0].gradient[i]), double(gradient[i]), 10*numeric_limits<T>::epsilon());
+		result.push_back(double(gradient[i]));
+	}
+	return result;
+}
+
+template<typename T, typename A>
+void compare(const vector<double>& expected, const vector<double>& point, double tolerance) {
+	for(int checked=1; checked>=0; checked--) {
+		vector<double> actual = run<T,A>(point, checked == 1);
+		for(int i=0; i<4; i++) {
+			CHECK_NEAR(actual[i], expected[i], tolerance);
+		}
+	}
+}
+
+int main() {
+	try {
+		vector<double> point = {0.7, 1.3, -0.4};
+		vector<double> expected = run<double,double>(point, true);
+		compare<float,float>(expected, point, 1e-5);
+		compare<float,double>(expected, point, 1e-5);
+		compare<long double,long double>(expected, point, 1e-15);
+	} catch(const char* e) {
+		cerr << "unexpected exception: " << e << "\n";
+		return 1;
+	}
+	return check::result();
+}
@@ -0,0 +1,91 @@
+//implicit solve and fixed-point nodes: values, gradients by the implicit function theorem, and failures
+#include "autoDiff.h"
+#include "check.h"
+
+using namespace std;
+
+void checkSolve() {
+	ad::Graph graph;
+	//y^3 + y = p*q
+	ad::Node& y = graph.input();
+	ad::Node& pq = graph.input();
+	y*y*y + y - pq;
+	ad::Function residual({&y, &pq});
+	ad::Node& p = graph.input();
+	ad::Node& q = graph.input();
+	ad::Node& root = ad::solve(residual, {&(p*q)}, 0.5);
+	root*p;
+	ad::Function f({&p, &q});
+
+	vector<double> point = {1.7, 0.9};
+	for(int checked=1; checked>=0; checked--) {
+		f.setChecked(checked == 1);
+		double value = f.evaluate(point);
+		double r = root.getValue();
+		CHECK_NEAR(r*r*r + r, 1.7*0.9, 1e-14);
+		CHECK_NEAR(value, r*1.7, 1e-14);
+		//dr/d(pq) = 1/(3r^2 + 1)
+		vector<double> gradient = f.differentiate(point);
+		double dr = 1/(3*r*r + 1);
+		CHECK_NEAR(gradient[0], r + 1.7*dr*0.9, 1e-12);
+		CHECK_NEAR(gradient[1], 1.7*dr*1.7, 1e-12);
+		vector<double> differences = check::finiteDifferences(f, point);
+		CHECK_NEAR(gradient[0], differences[0], 1e-6);
+		CHECK_NEAR(gradient[1], differences[1], 1e-6);
+		vector<ad::ValueAndGradient> batch = f.differentiateBatch({point, {0.4, 2.0}});
+		CHECK_NEAR(batch[0].gradient[1], gradient[1], 1e-12);
+	}
+
+	//the residual's mask would zero the derivatives the solve relies on
+	residual.setRequiresGradient(1, false);
+	CHECK_THROWS(f.differentiate(point));
+	residual.setRequiresGradient(1, true);
+}
+
+void checkFixedPoint() {
+	ad::Graph graph;
+	//y = tanh(y)/2 + p
+	ad::Node& y = graph.input();
+	ad::Node& p = graph.input();
+	0.5*tanh(y) + p;
+	ad::Function map({&y, &p});
+	ad::Node& r = graph.input();
+	ad::Node& fixed = ad::fixedPoint(map, {&r}, 0.0);
+	ad::Function f({&r});
+	double value = f.evaluate({0.3});
+	//iteration stops once a step is within a few hundred ulps
+	CHECK_NEAR(value, 0.5*tanh(value) + 0.3, 1e-12);
+	//dy/dp = 1/(1 - (1 - tanh(y)^2)/2)
+	double dy = 1/(1 - 0.5*(1 - tanh(value)*tanh(value)));
+	CHECK_NEAR(f.differentiate({0.3})[0], dy, 1e-12);
+	CHECK(fixed.getValue() == value);
+}
+
+//no real root: checked mode throws, unchecked mode gives NaN
+void checkFailure() {
+	ad::Graph graph;
+	ad::Node& y = graph.input();
+	ad::Node& p = graph.input();
+	y*y + p;
+	ad::Function residual({&y, &p});
+	ad::Node& q = graph.input();
+	ad::solve(residual, {&q}, 1.0, -1, 20);
+	ad::Function f({&q});
+	CHECK_NEAR(f.evaluate({-4.0}), 2.0, 1e-14);
+	CHECK_THROWS(f.evaluate({1.0}));
+	f.setChecked(false);
+	CHECK(std::isnan(f.evaluate({1.0})));
+	CHECK(!f.status().finite);
+}
+
+int main() {
+	try {
+		checkSolve();
+		checkFixedPoint();
+		checkFailure();
+	} catch(const char* e) {
+		cerr << "unexpected exception: " << e << "\n";
+		return 1;
+	}
+	return check::result();
+}
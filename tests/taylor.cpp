@@ -0,0 +1,184 @@
+//Function::taylor against an independent reference: the Taylor coefficients of g(t) = f(a + t*d) from the Cauchy
+//integral, evaluating the same formula in complex arithmetic at points around a circle
+#include "autoDiff.h"
+#include "check.h"
+#include <complex>
+#include <functional>
+#include <string>
+
+using namespace std;
+typedef complex<double> Complex;
+
+const double pi = 3.14159265358979323846;
+const int order = 8;
+
+//coefficients 0..order of g, from samples on a circle of the given radius
+vector<double> reference(function<Complex(Complex)> g, double radius) {
+	int nSamples = 64;
+	vector<double> coefficients;
+	for(int k=0; k<=order; k++) {
+		Complex sum = 0;
+		for(int s=0; s<nSamples; s++) {
+			Complex w = radius*exp(Complex(0, 2*pi*s/nSamples));
+			sum += g(w)*exp(Complex(0, -2*pi*k*s/nSamples));
+		}
+		coefficients.push_back((sum/double(nSamples)/pow(radius, k)).real());
+	}
+	return coefficients;
+}
+
+void checkCoefficients(const string& name, const vector<double>& actual, const vector<double>& expected) {
+	for(int k=0; k<=order; k++) {
+		if(!check::near(actual[k], expected[k], 1e-8)) {
+			cerr << name << ", coefficient " << k << ": " << actual[k] << " vs " << expected[k] << "\n";
+		}
+		CHECK_NEAR(actual[k], expected[k], 1e-8);
+	}
+}
+
+struct Case {
+	string name;
+	function<ad::Node&(ad::Node&, ad::Node&, ad::Node&)> build;
+	function<Complex(Complex, Complex, Complex)> f;
+	double radius;
+};
+
+Complex sigmoid(Complex u) {
+	return 1.0/(1.0 + exp(-u));
+}
+
+vector<Case> cases() {
+	return {
+		{"divide", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return x/y + 2.0/x + z/4.0; }, [](Complex x, Complex y, Complex z) { return x/y + 2.0/x + z/4.0; }, 0.3},
+		{"multiply", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return 3.0*x*y*z*(x - y); }, [](Complex x, Complex y, Complex z) { return 3.0*x*y*z*(x - y); }, 0.3},
+		{"log", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return log(x*y) + log(y, 3.0) + z; }, [](Complex x, Complex y, Complex z) { return log(x*y) + log(y)/log(3.0) + z; }, 0.3},
+		{"exp", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return exp(x*z) + y; }, [](Complex x, Complex y, Complex z) { return exp(x*z) + y; }, 0.3},
+		{"logSumExp", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return ad::logSumExp({&x, &y, &z}); }, [](Complex x, Complex y, Complex z) { return log(exp(x) + exp(y) + exp(z)); }, 0.3},
+		{"softmax", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return ad::softmax({&x, &y, &z}, 1); }, [](Complex x, Complex y, Complex z) { return exp(y)/(exp(x) + exp(y) + exp(z)); }, 0.3},
+		{"sigmoid", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return sigmoid(x*y) + z; }, [](Complex x, Complex y, Complex z) { return sigmoid(x*y) + z; }, 0.3},
+		{"softplus", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return softplus(x - y) + z; }, [](Complex x, Complex y, Complex z) { return log(1.0 + exp(x - y)) + z; }, 0.3},
+		{"pow", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return pow(x, y) + pow(y, 2.5) + pow(z, 3.0) + pow(2.0, x); },
+			[](Complex x, Complex y, Complex z) { return exp(y*log(x)) + pow(y, 2.5) + z*z*z + exp(x*log(2.0)); }, 0.3},
+		{"sqrt", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return sqrt(x + y) + z; }, [](Complex x, Complex y, Complex z) { return sqrt(x + y) + z; }, 0.3},
+		{"tanh", [](ad::Node& x, ad::Node& y, ad::Node& z) -> ad::Node& { return tanh(x - z) + y; }, [](Complex x, Complex y, Complex z) { return tanh(x - z) + y; }, 0.3},
+		{"example", [](ad::Node& x1, ad::Node& x2, ad::Node& x3) -> ad::Node& {
+			ad::Node& n1 = (4 + 2*x1 + 3*x2 - 5*x3)/(x1 + x3);
+			ad::Node& n2 = exp(x1/x2);
+			ad::Node& n3 = n2 + n1*n2;
+			return log(n1*n1*n3*n3)/2;
+		}, [](Complex x1, Complex x2, Complex x3) {
+			Complex n1 = (4.0 + 2.0*x1 + 3.0*x2 - 5.0*x3)/(x1 + x3);
+			Complex n2 = exp(x1/x2);
+			Complex n3 = n2 + n1*n2;
+			return log(n1*n1*n3*n3)/2.0;
+		}, 0.1},
+	};
+}
+
+void checkOperations() {
+	vector<double> a = {0.7, 1.3, -0.4}, d = {0.3, -0.2, 0.5};
+	for(const Case& c : cases()) {
+		ad::Graph graph;
+		ad::Node& x = graph.input();
+		ad::Node& y = graph.input();
+		ad::Node& z = graph.input();
+		c.build(x, y, z);
+		ad::Function f({&x, &y, &z});
+		function<Complex(Complex, Complex, Complex)> formula = c.f;
+		vector<double> expected = reference([&](Complex t) { return formula(a[0] + t*d[0], a[1] + t*d[1], a[2] + t*d[2]); }, c.radius);
+		checkCoefficients(c.name, f.taylor(a, d, order), expected);
+		f.setChecked(false);
+		checkCoefficients(c.name + " (unchecked)", f.taylor(a, d, order), expected);
+		CHECK_NEAR(f.taylor(a, d, 1)[1], f.directionalDerivative(a, d), 1e-12);
+	}
+}
+
+void checkSolve() {
+	ad::Graph graph;
+	//y^3 + y = p
+	ad::Node& y = graph.input();
+	ad::Node& p = graph.input();
+	y*y*y + y - p;
+	ad::Function residual({&y, &p});
+	ad::Node& q = graph.input();
+	ad::Node& scale = graph.input();
+	ad::solve(residual, {&q}, 0.5)*scale;
+	ad::Function f({&q, &scale});
+	vector<double> expected = reference([](Complex t) {
+		Complex p = 1.7 + 0.4*t, y = 0.5;
+		for(int i=0; i<100; i++) {
+			y -= (y*y*y + y - p)/(3.0*y*y + 1.0);
+		}
+		return y*(0.9 + 0.3*t);
+	}, 0.3);
+	checkCoefficients("solve", f.taylor({1.7, 0.9}, {0.4, 0.3}, order), expected);
+
+	//y = tanh(y)/2 + p
+	ad::Node& fy = graph.input();
+	ad::Node& fp = graph.input();
+	0.5*tanh(fy) + fp;
+	ad::Function map({&fy, &fp});
+	ad::Node& r = graph.input();
+	ad::fixedPoint(map, {&r}, 0.0);
+	ad::Function g({&r});
+	expected = reference([](Complex t) {
+		Complex y = 0;
+		for(int i=0; i<200; i++) {
+			y = 0.5*tanh(y) + 0.3 + t;
+		}
+		return y;
+	}, 0.3);
+	checkCoefficients("fixedPoint", g.taylor({0.3}, {1.0}, order), expected);
+
+	vector<double> gradient = g.differentiate({0.3});
+	CHECK_NEAR(g.taylor({0.3}, {1.0}, 1)[1], gradient[0], 1e-10);
+}
+
+void checkSpecialCases() {
+	//x^3 at x = 0 along 2: 8t^3
+	ad::Graph graph;
+	ad::Node& x = graph.input();
+	pow(x, 3.0);
+	ad::Function f({&x});
+	vector<double> cube = f.taylor({0.0}, {2.0}, 5);
+	CHECK(cube[0] == 0 && cube[1] == 0 && cube[2] == 0 && cube[4] == 0 && cube[5] == 0);
+	CHECK_NEAR(cube[3], 8.0, 1e-14);
+
+	//an operation with no Taylor rule is exact to first order, and throws beyond it
+	ad::Graph scalarGraph;
+	ad::Node& s = scalarGraph.input();
+	ad::apply({&s}, new ad::ScalarOperation([](const vector<double>& v) { return v[0]*v[0]; }, [](const vector<double>& v, double) { return vector<double>{2*v[0]}; }, 1));
+	ad::Function g({&s});
+	vector<double> first = g.taylor({3.0}, {1.0}, 1);
+	CHECK(first[0] == 9.0 && first[1] == 6.0);
+	CHECK_THROWS(g.taylor({3.0}, {1.0}, 2));
+
+	//inputs that are polynomials in t: (1 + 2t + 3t^2)(2 - t) = 2 + 3t + 4t^2 - 3t^3
+	ad::Graph productGraph;
+	ad::Node& u = productGraph.input();
+	ad::Node& v = productGraph.input();
+	u*v;
+	ad::Function p({&u, &v});
+	CHECK(p.taylor({{1.0, 2.0, 3.0, 0.0}, {2.0, -1.0, 0.0, 0.0}}) == vector<double>({2.0, 3.0, 4.0, -3.0}));
+	CHECK_THROWS(p.taylor({{1.0, 2.0}, {2.0}}));
+	CHECK_THROWS(p.taylor({1.0, 2.0}, {1.0, 0.0}, -1));
+
+	//checked mode checks the point itself
+	ad::Graph logGraph;
+	ad::Node& l = logGraph.input();
+	log(l);
+	ad::Function h({&l});
+	CHECK_THROWS(h.taylor({-1.0}, {1.0}, 3));
+}
+
+int main() {
+	try {
+		checkOperations();
+		checkSolve();
+		checkSpecialCases();
+	} catch(const char* e) {
+		cerr << "unexpected exception: " << e << "\n";
+		return 1;
+	}
+	return check::result();
+}
@@ -0,0 +1,80 @@
+//unchecked mode: the same results as checked mode, and NaN or infinity reported through the status instead of thrown
+#include "autoDiff.h"
+#include "check.h"
+
+using namespace std;
+
+void checkAgreement() {
+	ad::Node x, y, z;
+	ad::Node copy = z;
+	ad::Node& a = (x - y)/(1.0 - z) + 2.0/x;
+	ad::Node& b = log(x*y, 2.0) + exp(0.0 - copy) + pow(y, 3.0);
+	ad::Node output = tanh(a)*sigmoid(b) + softplus(a - b) + sqrt(x + y) + ad::logSumExp({&a, &b, &z});
+	ad::Function f({&x, &y, &z});
+	vector<vector<double>> points = {{0.7, 1.3, -0.4}, {1.1, 0.6, 0.9}, {2.0, 1.7, 0.2}};
+	vector<vector<double>> gradients;
+	vector<double> values;
+	for(const vector<double>& point : points) {
+		values.push_back(f.evaluate(point));
+		gradients.push_back(f.differentiate(point));
+	}
+	f.setChecked(false);
+	CHECK(!f.isChecked());
+	vector<ad::ValueAndGradient> batch = f.differentiateBatch(points);
+	for(int b=0; b<(int)points.size(); b++) {
+		CHECK_NEAR(f.evaluate(points[b]), values[b], 1e-14);
+		vector<double> gradient = f.differentiate(points[b]);
+		CHECK(f.status().finite);
+		for(int i=0; i<3; i++) {
+			CHECK_NEAR(gradient[i], gradients[b][i], 1e-13);
+			CHECK_NEAR(batch[b].gradient[i], gradients[b][i], 1e-13);
+		}
+		//the nodes are left as the checked path leaves them
+		CHECK_NEAR(output.getValue(), values[b], 1e-14);
+		CHECK_NEAR(x.getDerivative(), gradients[b][0], 1e-13);
+	}
+}
+
+void checkDiagnostics() {
+	ad::Node x, y;
+	ad::Node& root = sqrt(x);
+	ad::Node& logarithm = log(y);
+	ad::Node output = root + logarithm;
+	ad::Function f({&x, &y});
+	f.setChecked(false);
+
+	//the forward value is finite but the derivative of sqrt at 0 isn't
+	f.differentiate({0.0, 1.0});
+	CHECK(!f.status().finite);
+	CHECK(f.status().duringDifferentiation);
+	CHECK(f.status().node == &root);
+	CHECK(f.evaluate({4.0, 1.0}) == 2.0);
+	CHECK(f.status().finite);
+
+	CHECK(std::isnan(f.evaluate({1.0, -1.0})));
+	CHECK(!f.status().finite);
+	CHECK(!f.status().duringDifferentiation);
+	CHECK(f.status().node == &logarithm);
+	CHECK(f.status().operation != nullptr);
+
+	//a bad arg is blamed on its input node, and a batch says which point
+	ad::NumericalStatus status;
+	f.evaluateBatch({{1.0, 1.0}, {1.0, 2.0}, {NAN, 1.0}}, &status);
+	CHECK(!status.finite && status.point == 2 && status.node == &x && status.operation == nullptr);
+	f.differentiateBatch({{1.0, 1.0}, {1.0, 2.0}}, &status);
+	CHECK(status.finite);
+
+	f.setChecked(true);
+	CHECK_THROWS(f.evaluate({1.0, -1.0}));
+}
+
+int main() {
+	try {
+		checkAgreement();
+		checkDiagnostics();
+	} catch(const char* e) {
+		cerr << "unexpected exception: " << e << "\n";
+		return 1;
+	}
+	return check::result();
+}